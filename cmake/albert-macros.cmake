@@ -28,6 +28,7 @@
 # |  plugin_dependencies | string list  | Default: `[]`. Required plugins.                                          |
 # |              credits | string list  | Default: `[]`. Attributions, mentions, third party library licenses, …    |
 # |             loadtype |    string    | Default: `user`. `frontend` or `user`.                                    |
+# |      lazy_activation |     bool     | Default: `false`. Load on first trigger use. See PluginMetaData.          |
 #
 # Note: Local string types can be used to localize the metadata. (e.g. "name[de]": "Anwendungen")
 #
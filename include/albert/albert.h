@@ -36,9 +36,11 @@ ALBERT_EXPORT std::filesystem::path cacheLocation();
 ALBERT_EXPORT std::filesystem::path dataLocation();
 
 /// Returns a QSettings object for configuration storage.
+/// Prefer util::SettingsStore::config() for frequent reads and writes.
 ALBERT_EXPORT std::unique_ptr<QSettings> settings();
 
 /// Returns a QSettings object for state storage.
+/// Prefer util::SettingsStore::state() for frequent reads and writes.
 ALBERT_EXPORT std::unique_ptr<QSettings> state();
 
 /// Returns a const reference to the extension registry.
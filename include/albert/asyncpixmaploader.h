@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2025 Manuel Schneider
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <QObject>
+#include <QPixmap>
+#include <QSize>
+#include <QStringList>
+#include <albert/export.h>
+#include <memory>
+
+namespace albert::util
+{
+
+///
+/// Asynchronous, row based pixmap loader for item views.
+///
+/// Returns cached pixmaps or a placeholder immediately and resolves the icon URLs in a worker
+/// pool. Image files are decoded (and downscaled while decoding) into QImage in the workers. The
+/// conversion to QPixmap happens in the thread the loader lives in, which has to be the GUI
+/// thread. On platforms supporting it, `xdg:` icons are looked up in the workers as well. URL
+/// schemes that cannot be resolved off the GUI thread are resolved synchronously using
+/// pixmapFromUrl(const QString &url, const QSize &requestedSize, qreal devicePixelRatio) when
+/// their turn comes.
+///
+/// Requests of visible rows are prioritized. Pending requests of rows that leave the visible
+/// range are cancelled.
+///
+/// Results share the cache of pixmapFromUrl(const QString &url, const QSize &requestedSize),
+/// which decodes images the same way.
+///
+/// \since 0.28
+///
+class ALBERT_EXPORT AsyncPixmapLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /// Constructs a loader with a null pixmap as placeholder.
+    explicit AsyncPixmapLoader(QObject *parent = nullptr);
+    ~AsyncPixmapLoader() override;
+
+    /// The pixmap returned while a request is pending.
+    const QPixmap &placeholder() const;
+
+    /// Sets the pixmap returned while a request is pending.
+    void setPlaceholder(const QPixmap &placeholder);
+
+    /// The maximum number of worker threads. Default: half the ideal thread count, at least one.
+    int maxThreadCount() const;
+
+    /// Sets the maximum number of worker threads.
+    void setMaxThreadCount(int count);
+
+    ///
+    /// Requests the pixmap of the first available URL for `row`.
+    ///
+    /// Supersedes any pending request for `row`.
+    ///
+    /// \param row The row the pixmap is requested for.
+    /// \param urls The icon URLs. See pixmapFromUrl(const QString &url, const QSize &requestedSize).
+    /// \param size The size in device independent pixels the pixmap should have if possible.
+    /// \param devicePixelRatio The device pixel ratio of the target surface.
+    /// \returns The pixmap if it is cached, the placeholder otherwise. In the latter case
+    ///          pixmapReady is emitted when the pixmap is available.
+    ///
+    QPixmap request(int row, const QStringList &urls, const QSize &size, qreal devicePixelRatio = 1.);
+
+    ///
+    /// Sets the range of visible rows.
+    ///
+    /// Pending requests for rows outside of [first, last] are cancelled, requests for rows inside
+    /// the range are scheduled with high priority. Default: all rows.
+    ///
+    void setVisibleRows(int first, int last);
+
+    /// Cancels the pending request of `row`.
+    void cancel(int row);
+
+    /// Cancels all pending requests. Use this when the rows of the model get reset.
+    void cancelAll();
+
+signals:
+
+    /// Emitted in the thread of the loader when the requested pixmap of `row` is available.
+    /// `pixmap` is null if none of the URLs yielded a pixmap.
+    void pixmapReady(int row, const QPixmap &pixmap);
+
+private:
+
+    class Private;
+    std::unique_ptr<Private> d;
+
+};
+
+}
@@ -22,7 +22,8 @@ namespace albert::util
 /// - `qrc:<path>` Use the file at path in the [resource collection] as icon.
 /// - `qfip:<path>` Uses fileIcon(const QString &path)
 /// - `qsp:<pixmap enumerator>` Get an icon from [QStyle::StandardPixmap] enum.
-/// - `xdg:<icon name>` Uses xdgIconLookup(const QString &name);
+/// - `xdg:<icon name>` Uses xdgIconLookup(const QString &name, const QSize &size). Falls back to
+///   [QIcon::fromTheme] on misses.
 /// - `gen:<>` Uses genericPixmapFactory. See also [QColor::fromString].
 /// - `mask:?src=&radius=` Masks a given icon url.
 /// - `comp:?src1=<>&src2=<>` Composes two given icons.
@@ -43,12 +44,30 @@ namespace albert::util
 /// \returns The pixmap, if available, null pixmap otherwise. The size can be smaller
 ///         than requestedSize, but is never larger.
 ///
+/// Rendered pixmaps are kept in a size bounded, thread-safe cache, which is cleared when the
+/// icon theme changes. Pixmaps of files are rendered again if the file has been modified.
+///
 /// [resource collection]: https://doc.qt.io/qt-6/resources.html
 /// [QStyle::StandardPixmap]: https://doc.qt.io/qt-6/qstyle.html#StandardPixmap-enum
 /// [QColor::fromString]: https://doc.qt.io/qt/qcolor.html#fromString
+/// [QIcon::fromTheme]: https://doc.qt.io/qt-6/qicon.html#fromTheme
 ///
 QPixmap ALBERT_EXPORT pixmapFromUrl(const QString &url, const QSize &requestedSize);
 
+///
+/// High DPI aware URL based icon factory.
+///
+/// See pixmapFromUrl(const QString &url, const QSize &requestedSize).
+///
+/// \param url The icon URL.
+/// \param requestedSize The size in device independent pixels the pixmap should have if possible.
+/// \param devicePixelRatio The device pixel ratio of the target surface.
+/// \returns The pixmap rendered at `requestedSize * devicePixelRatio` with its device pixel ratio
+///          set, if available, null pixmap otherwise.
+/// \since 0.28
+///
+QPixmap ALBERT_EXPORT pixmapFromUrl(const QString &url, const QSize &requestedSize, qreal devicePixelRatio);
+
 ///
 /// URL list based icon factory.
 ///
@@ -130,5 +149,21 @@ QIcon ALBERT_EXPORT fileIcon(const QString &path);
 QString ALBERT_EXPORT xdgIconLookup(const QString &name);
 #endif
 
+///
+/// Performs a size aware icon lookup according to the [freedesktop icon theme specification].
+///
+/// Available only on platforms supporting it. Thread-safe.
+///
+/// [freedesktop icon theme specification]: https://specifications.freedesktop.org/icon-theme-spec/latest/
+///
+/// \param name The icon name.
+/// \param size The size in device pixels the icon will be used at.
+/// \returns The path of the icon closest to `size` if available, null string otherwise.
+/// \since 0.28
+///
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+QString ALBERT_EXPORT xdgIconLookup(const QString &name, const QSize &size);
+#endif
+
 }
 
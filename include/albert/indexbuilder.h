@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2025 Manuel Schneider
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <QString>
+#include <albert/export.h>
+#include <albert/item.h>
+#include <memory>
+class ItemIndex;
+
+namespace albert::util
+{
+
+///
+/// Streaming builder of an item index.
+///
+/// Lookup strings are tokenized and appended to the index data as they are added, i.e. there is
+/// no need to materialize a list of all \ref IndexItem "index items" before building the index.
+/// commit() finalizes the index and replaces the items of the index the builder was created for.
+///
+/// The builder is not threadsafe, but may be used in any thread.
+///
+/// \sa \ref IndexQueryHandler::indexBuilder
+/// \since 0.28
+///
+class ALBERT_EXPORT IndexBuilder final
+{
+public:
+
+    IndexBuilder(IndexBuilder &&);
+    IndexBuilder &operator=(IndexBuilder &&);
+    ~IndexBuilder();
+
+    ///
+    /// Adds the lookup `string` for `item`.
+    ///
+    /// Items can be added multiple times with different strings.
+    ///
+    void add(std::shared_ptr<Item> item, const QString &string);
+
+    ///
+    /// Builds the index and replaces the items of the index.
+    ///
+    /// The builder is empty afterwards and can be reused.
+    ///
+    void commit();
+
+    class Private;
+
+private:
+
+    explicit IndexBuilder(std::unique_ptr<Private>);
+    std::unique_ptr<Private> d;
+
+    friend class ::ItemIndex;
+
+};
+
+}
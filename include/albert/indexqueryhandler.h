@@ -4,7 +4,9 @@
 #pragma once
 #include <QString>
 #include <albert/globalqueryhandler.h>
+#include <albert/indexbuilder.h>
 #include <albert/indexitem.h>
+#include <albert/matchconfig.h>
 #include <memory>
 #include <vector>
 
@@ -23,7 +25,7 @@ public:
     bool supportsFuzzyMatching() const override;
 
     /// Set the fuzzy mode of the internal index.
-    /// Triggers a rebuild by calling updateIndexItems.
+    /// Keeps the remaining match config. Triggers a rebuild by calling updateIndexItems.
     void setFuzzyMatching(bool) override;
 
     /// Uses the index to override GlobalQueryHandler::handleGlobalQuery
@@ -33,7 +35,7 @@ public:
     /// Called when the index needs to be updated, i.e. for initialization
     /// and on user changes to the index config (fuzzy, etc…) and probably by
     /// the client itself if the items changed. This function should call
-    /// setIndexItems(std::vector<IndexItem>&&) to update the index.
+    /// setIndexItems(std::vector<IndexItem>&&) or use an indexBuilder() to update the index.
     /// @note Don't call this method in the constructor. It will be called on plugin
     /// initialization.
     virtual void updateIndexItems() = 0;
@@ -43,10 +45,26 @@ public:
     /// @threadsafe
     void setIndexItems(std::vector<IndexItem>&&);
 
+    /// Returns a streaming builder for the index.
+    /// Use this in updateIndexItems() instead of setIndexItems() to avoid materializing the
+    /// index items. IndexBuilder::commit() sets the items of the index. The builder must not
+    /// outlive the handler.
+    /// @threadsafe
+    /// \since 0.28
+    IndexBuilder indexBuilder();
+
 protected:
 
     ~IndexQueryHandler() override;
 
+    /// Returns the match config of the index.
+    /// Override this to configure the matching, e.g. to enable infix matching or to choose
+    /// the fuzzy lookup algorithm. Called when the index is created. The `fuzzy` member is
+    /// ignored, it is set by setFuzzyMatching(). The base implementation returns the default
+    /// config.
+    /// \since 0.28
+    virtual MatchConfig matchConfig() const;
+
 private:
 
     class Private;
@@ -15,6 +15,10 @@ namespace albert::util
 ///
 /// Stores input strings and provides a search iterator.
 ///
+/// Additions are appended to the history file immediately. The file is compacted when it
+/// accumulated enough superseded entries. Patterns of three or more characters are looked up in a
+/// trigram index.
+///
 class ALBERT_EXPORT InputHistory final : public QObject
 {
     Q_OBJECT
@@ -27,7 +31,7 @@ public:
     ///
     /// Adds text to history search.
     ///
-    /// Skips empty strings and drops duplicates.
+    /// Skips empty strings. Adding an existing entry moves it to the front.
     ///
     /// @param str The string to add.
     ///
@@ -60,13 +64,15 @@ public:
     Q_INVOKABLE void clear();
 
     ///
-    /// Returns the maximum amount of history entries.
+    /// Returns the maximum amount of history entries. Defaults to 10000.
     ///
     Q_INVOKABLE uint limit() const;
 
     ///
     /// Sets the maximum amount of history entries.
     ///
+    /// Drops the oldest entries exceeding the limit. The limit is not persisted.
+    ///
     Q_INVOKABLE void setLimit(uint);
 
 private:
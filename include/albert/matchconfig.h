@@ -48,6 +48,62 @@ public:
     ///
     QRegularExpression separator_regex = default_separator_regex;
 
+    ///
+    /// Algorithms to look up error tolerant matches in an index.
+    ///
+    /// \since 0.28
+    ///
+    enum class FuzzyLookup {
+        NGram,     ///< Preselects words sharing enough bigrams, then verifies them one by one.
+        Automaton  ///< Walks a word trie with a Levenshtein automaton, pruning whole subtrees.
+    };
+
+    ///
+    /// The algorithm used to look up fuzzy matches in an index.
+    ///
+    /// Has no effect if `fuzzy` is disabled or on plain string matching. Index query handlers
+    /// choose it in IndexQueryHandler::matchConfig().
+    ///
+    /// \since 0.28
+    ///
+    FuzzyLookup fuzzy_lookup = FuzzyLookup::NGram;
+
+    ///
+    /// The query word length up to which fuzzy matches are looked up in a deletion index.
+    ///
+    /// The index maps the strings obtained by deleting up to the allowed errors from the word
+    /// prefixes to these prefixes, i.e. the fuzzy matches of short words take a few hash
+    /// lookups. Memory grows roughly quadratic with this length. 0 disables the index. Has no
+    /// effect if `fuzzy` is disabled or on plain string matching. Index query handlers set it
+    /// in IndexQueryHandler::matchConfig().
+    ///
+    /// \since 0.28
+    ///
+    uint typo_index_length = 0;
+
+    ///
+    /// Match words containing the query words, not only words starting with them.
+    ///
+    /// Infix matches count half the length of the query word, i.e. they rank below prefix
+    /// matches. Query words shorter than two characters do not match infixes. Has no effect on
+    /// plain string matching.
+    ///
+    /// \since 0.28
+    ///
+    bool infix = false;
+
+    ///
+    /// Match the initials of the words and camel humps, e.g. "vsc" for "Visual Studio Code".
+    ///
+    /// Initials matches score strictly below word matches, i.e. an item matched by its
+    /// initials only ranks below all items matched by words. Among each other initials matches
+    /// rank by the matched fraction of the initials. Query words shorter than two characters do
+    /// not match initials. Has no effect on multi-word queries and plain string matching.
+    ///
+    /// \since 0.28
+    ///
+    bool initials = false;
+
     ///
     /// The error tolerance.
     ///
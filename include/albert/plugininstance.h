@@ -5,6 +5,7 @@
 #include <QString>
 #include <albert/config.h>
 #include <albert/export.h>
+#include <albert/settingsstore.h>
 #include <filesystem>
 #include <memory>
 #include <vector>
@@ -74,6 +75,17 @@ public:
     /// @returns Preconfigured QSettings object for state storage.
     [[nodiscard]] std::unique_ptr<QSettings> state() const;
 
+    /// Persistent plugin settings served from memory.
+    /// The section titled <plugin-id> of util::SettingsStore::config(). Opt-in alternative to
+    /// settings(), e.g. for the ALBERT_PROPERTY macros. Changes are written back delayed.
+    /// @since 0.28
+    [[nodiscard]] util::SettingsGroup cachedSettings() const;
+
+    /// Persistent plugin state served from memory.
+    /// The section titled <plugin-id> of util::SettingsStore::state().
+    /// @since 0.28
+    [[nodiscard]] util::SettingsGroup cachedState() const;
+
     /// Reads the keychain value for `key`.
     /// Convenience function avoiding name conflicts.
     [[nodiscard]] QString readKeychain(const QString & key) const;
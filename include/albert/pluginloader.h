@@ -26,7 +26,7 @@ public:
     virtual const PluginMetaData &metaData() const = 0;
 
     /// Load the plugin.
-    /// Called in a background thread.
+    /// Called in a background thread, possibly concurrently with the loaders of other plugins.
     /// Expects the plugin to be loaded after this call.
     /// @throws std::exception in case of errors.
     virtual void load() = 0;
@@ -36,7 +36,7 @@ public:
     virtual void unload() = 0;
 
     /// The plugin instance.
-    /// Not called unless loaded.
+    /// Not called unless loaded. Called in the main thread.
     /// Creates an instance of the plugin if it does not exist.
     /// @return @copybrief createInstance
     virtual PluginInstance *createInstance() = 0;
@@ -74,6 +74,13 @@ public:
     /// \sa Loadtype
     LoadType load_type{LoadType::User};
 
+    /// Whether the plugin may be loaded on the first use of its triggers.
+    /// Applies to plugins providing trigger query handlers only. Opt in only if the plugin has
+    /// no effects besides these handlers, e.g. no watchers, timers or hotkeys set up on
+    /// construction, since these are deferred as well.
+    /// \since 0.28
+    bool lazy_activation{false};
+
 };
 
 }
@@ -31,7 +31,9 @@
 /// @param name The name of the property
 /// @param defaultValue The default value of the property
 /// @param settings Something that evaluates to a  dereferencable QSettings
-///        object (*, ->). A pointer, factory, etc.
+///        object (*, ->). A pointer, factory, etc. Opt in to in-memory settings
+///        using PluginInstance::cachedSettings, which avoids disk I/O on every
+///        change. Do not mix it with PluginInstance::settings for the same keys.
 ///
 #define ALBERT_PROPERTY_BASE(type, name, defaultValue, settings) \
     public: static type name##_default(){ return defaultValue; }; \
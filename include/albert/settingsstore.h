@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: 2025 Manuel Schneider
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <albert/export.h>
+#include <memory>
+
+namespace albert::util
+{
+
+///
+/// Process-wide, in-memory settings store backed by an INI file.
+///
+/// Reads are served from an immutable snapshot of the file which is swapped atomically on
+/// changes, i.e. reads neither touch the disk nor wait for writers. Writes update the snapshot
+/// immediately and are written back to the file in batches on a worker thread once no further
+/// writes arrived for a short while. Pending writes are flushed when the application quits.
+///
+/// The stores stay coherent with the QSettings objects returned by albert::settings() and
+/// albert::state(): Pending changes are written back before these objects are created and the
+/// stores reload the file if these objects changed it.
+///
+/// \since 0.28
+///
+class ALBERT_EXPORT SettingsStore : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /// The store of the configuration file. See albert::settings().
+    static SettingsStore &config();
+
+    /// The store of the state file. See albert::state().
+    static SettingsStore &state();
+
+    /// The path of the backing file.
+    const QString &fileName() const;
+
+    /// Returns the value of `key` or `defaultValue` if the key does not exist.
+    QVariant value(const QString &key, const QVariant &defaultValue = {}) const;
+
+    /// Returns the value of `key` converted to `T` or `defaultValue` if the key does not exist.
+    template<typename T>
+    T value(const QString &key, const T &defaultValue) const
+    { return value(key, QVariant::fromValue(defaultValue)).template value<T>(); }
+
+    /// Returns true if `key` exists.
+    bool contains(const QString &key) const;
+
+    /// Sets the value of `key` to `value`.
+    void setValue(const QString &key, const QVariant &value);
+
+    /// Removes `key` and all its subkeys.
+    void remove(const QString &key);
+
+    /// Writes pending changes to the file. Blocks until done.
+    void sync();
+
+    /// Rereads the file if it has been modified by someone else.
+    void reload();
+
+signals:
+
+    /// Emitted when the value of `key` changed. `value` is invalid if the key has been removed.
+    /// Emitted in the thread that caused the change.
+    void valueChanged(const QString &key, const QVariant &value);
+
+private:
+
+    explicit SettingsStore(const QString &fileName);
+    ~SettingsStore() override;
+
+    class Private;
+    std::unique_ptr<Private> d;
+
+};
+
+
+///
+/// A group of a SettingsStore.
+///
+/// Prefixes all keys with `<group>/`. Dereferenceable (->) like a pointer to QSettings to be
+/// usable with the property macros in property.h.
+///
+/// \since 0.28
+///
+class SettingsGroup
+{
+public:
+
+    SettingsGroup(SettingsStore &store, const QString &group):
+        store_(store), prefix_(group + QLatin1Char('/')) {}
+
+    QVariant value(const QString &key, const QVariant &defaultValue = {}) const
+    { return store_.value(prefix_ + key, defaultValue); }
+
+    bool contains(const QString &key) const
+    { return store_.contains(prefix_ + key); }
+
+    void setValue(const QString &key, const QVariant &value) const
+    { store_.setValue(prefix_ + key, value); }
+
+    void remove(const QString &key) const
+    { store_.remove(prefix_ + key); }
+
+    const SettingsGroup *operator->() const { return this; }
+
+private:
+
+    SettingsStore &store_;
+    const QString prefix_;
+
+};
+
+}
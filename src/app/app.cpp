@@ -5,9 +5,11 @@
 #include "appqueryhandler.h"
 #include "extensionregistry.h"
 #include "frontend.h"
+#include "headlessqueryservice.h"
 #include "iconprovider.h"
 #include "logging.h"
 #include "messagehandler.h"
+#include "pixmapcache.h"
 #include "platform.h"
 #include "plugininstance.h"
 #include "pluginloader.h"
@@ -21,10 +23,12 @@
 #include "report.h"
 #include "rpcserver.h"
 #include "session.h"
+#include "settingsstore.h"
 #include "settingswindow.h"
 #include "signalhandler.h"
 #include "systemutil.h"
 #include "telemetry.h"
+#include "trace.h"
 #include "triggersqueryhandler.h"
 #include "urlhandler.h"
 #include <QByteArray>
@@ -90,6 +94,7 @@ public:
     PluginRegistry plugin_registry;
     QtPluginProvider plugin_provider;
     QueryEngine query_engine;
+    HeadlessQueryService query_service;
     Telemetry telemetry;
 
     // Weak, lazy or optional
@@ -112,6 +117,7 @@ App::Private::Private(const QStringList &additional_plugin_paths, bool load_enab
     plugin_registry(extension_registry, load_enabled),
     plugin_provider(additional_plugin_paths),
     query_engine(extension_registry),
+    query_service(query_engine),
     telemetry(extension_registry),
     plugin_query_handler(plugin_registry),
     triggers_query_handler(query_engine)
@@ -121,6 +127,9 @@ void App::Private::initialize()
 {
     platform::initPlatform();
 
+    // Themed icons are resolved at render time
+    PixmapCache::instance().watchThemeChanges(qApp);
+
     // Install scheme handler
     QDesktopServices::setUrlHandler("albert", app_instance, "handleUrl");
 
@@ -129,6 +138,7 @@ void App::Private::initialize()
     platform::initNativeWindow(frontend->winId());
 
     // Invalidate sessions on handler removal or visibility change
+    // Rerun the query when lazily activated plugins replaced their proxies
     auto reset_session = [this]{
         session.reset();
         if (frontend->isVisible())
@@ -136,8 +146,9 @@ void App::Private::initialize()
     };
     connect(frontend, &Frontend::visibleChanged, app_instance, reset_session);
     connect(&query_engine, &QueryEngine::handlerRemoved, app_instance, reset_session);
+    connect(&plugin_registry, &PluginRegistry::activatedOnFirstUse, app_instance, reset_session);
 
-    if (settings()->value(CFG_SHOWTRAY, DEF_SHOWTRAY).toBool())
+    if (SettingsStore::config().value(CFG_SHOWTRAY, DEF_SHOWTRAY).toBool())
         initTrayIcon();
 
     notifyVersionChange();
@@ -232,7 +243,7 @@ void App::Private::initHotkey()
         return;
     }
 
-    auto s_hk = settings()->value(CFG_HOTKEY, DEF_HOTKEY).toString();
+    auto s_hk = SettingsStore::config().value(CFG_HOTKEY, DEF_HOTKEY).toString();
 
     if (s_hk.isEmpty())
     {
@@ -263,16 +274,8 @@ void App::Private::initHotkey()
 
 void App::Private::initRPC()
 {
-    auto messageHandler = [](const QByteArray bytes) -> QByteArray
+    auto handleCommand = [](const QByteArray &bytes, const QStringList &args) -> QByteArray
     {
-        INFO << "Received RPC message:" << bytes;
-
-        const auto array = QJsonDocument::fromJson(bytes).array();
-
-        QStringList args;
-        for (const QJsonValue &value : array)
-            args << value.toString();
-
         if (args.size() == 0)
         {
             WARN << "Received Invalid message expected json array of strings.";
@@ -331,6 +334,28 @@ void App::Private::initRPC()
             else
                 return "'quit' expects no arguments.";
 
+        else if (args[0] == "trace")
+        {
+            // trace start|stop|dump: records spans, dump prints Chrome trace event JSON
+            if (args.size() != 2)
+                return "'trace' expects one of start, stop, dump.";
+
+            else if (args[1] == "start")
+            {
+                Trace::clear();
+                Trace::setEnabled(true);
+            }
+
+            else if (args[1] == "stop")
+                Trace::setEnabled(false);
+
+            else if (args[1] == "dump")
+                return Trace::chromeTraceJson();
+
+            else
+                return "'trace' expects one of start, stop, dump.";
+        }
+
         else if (args[0] == "report")
 
             if (args.size() == 1)
@@ -350,14 +375,43 @@ void App::Private::initRPC()
         return {};
     };
 
-    rpc_server.setMessageHandler(messageHandler);
+    rpc_server.setMessageHandler([this, handleCommand](const QByteArray &bytes, RPCServer::Response response)
+    {
+        INFO << "Received RPC message:" << bytes;
+
+        const auto array = QJsonDocument::fromJson(bytes).array();
+
+        QStringList args;
+        for (const QJsonValue &value : array)
+            args << value.toString();
+
+        if (!args.isEmpty() && args[0] == "query")
+        {
+            // query [--json] <string>: JSON lines streamed while matches arrive or one document
+            auto format = HeadlessQueryService::Format::JsonLines;
+            if (args.size() == 3 && args[1] == "--json")
+                format = HeadlessQueryService::Format::Json;
+            else if (args.size() != 2)
+                return response.close("'query' expects [--json] <query>.");
+
+            query_service.run(args.last(), format,
+                              [response](const QByteArray &bytes)
+                              {
+                                  response.write(bytes);
+                                  return response.isOpen();
+                              },
+                              [response]{ response.close(); });
+        }
+        else
+            response.close(handleCommand(bytes, args));
+    });
 }
 
 void App::Private::loadAnyFrontend()
 {
     auto frontend_plugins = plugin_provider.frontendPlugins();
 
-    auto cfg_frontend = settings()->value(CFG_FRONTEND_ID, DEF_FRONTEND_ID).toString();
+    auto cfg_frontend = SettingsStore::config().value(CFG_FRONTEND_ID, DEF_FRONTEND_ID).toString();
     DEBG << QString("Try loading the configured frontend '%1'.").arg(cfg_frontend);
     if (auto it = find_if(frontend_plugins.begin(), frontend_plugins.end(),
                           [&](const PluginLoader *loader){ return cfg_frontend == loader->metaData().id; });
@@ -524,7 +578,7 @@ QStringList App::availableFrontends()
 void App::setFrontend(uint i)
 {
     auto fp = d->plugin_provider.frontendPlugins().at(i);
-    settings()->setValue(CFG_FRONTEND_ID, fp->metaData().id);
+    SettingsStore::config().setValue(CFG_FRONTEND_ID, fp->metaData().id);
 
     auto text = tr("Changing the frontend requires a restart. "
                    "Do you want to restart Albert?");
@@ -545,7 +599,7 @@ void App::setTrayEnabled(bool enable)
     }
     else
         return;
-    settings()->setValue(CFG_SHOWTRAY, enable);
+    SettingsStore::config().setValue(CFG_SHOWTRAY, enable);
 }
 
 const QHotkey *App::hotkey() const { return d->hotkey.get(); }
@@ -555,14 +609,14 @@ void App::setHotkey(unique_ptr<QHotkey> hk)
     if (!hk)
     {
         d->hotkey.reset();
-        settings()->setValue(CFG_HOTKEY, QString{});
+        SettingsStore::config().setValue(CFG_HOTKEY, QString{});
     }
     else if (hk->isRegistered())
     {
         d->hotkey = ::move(hk);
         connect(d->hotkey.get(), &QHotkey::activated,
                 d->frontend, []{ App::instance()->toggle(); });
-        settings()->setValue(CFG_HOTKEY, d->hotkey->shortcut().toString());
+        SettingsStore::config().setValue(CFG_HOTKEY, d->hotkey->shortcut().toString());
     }
     else
         WARN << "Set unregistered hotkey. Ignoring.";
@@ -605,9 +659,16 @@ int ALBERT_EXPORT run(int argc, char **argv)
                                         App::tr("Print report and quit."));
         auto opt_n = QCommandLineOption({"n", "no-autoload"},
                                         App::tr("Do not implicitly load enabled plugins."));
+        auto opt_q = QCommandLineOption({"q", "query"},
+                                        App::tr("Run a query in the running instance and print "
+                                                "the results as JSON. Repeatable."),
+                                        App::tr("query"));
+        auto opt_s = QCommandLineOption("stream",
+                                        App::tr("Print the results of queries as JSON lines "
+                                                "while they arrive."));
 
         QCommandLineParser parser;
-        parser.addOptions({opt_p, opt_r, opt_n});
+        parser.addOptions({opt_p, opt_r, opt_n, opt_q, opt_s});
         parser.addPositionalArgument(App::tr("command"),
                                      App::tr("RPC command to send to the running instance."),
                                      App::tr("[command [params...]]"));
@@ -616,13 +677,53 @@ int ALBERT_EXPORT run(int argc, char **argv)
         parser.setApplicationDescription(App::tr("Launch Albert or control a running instance."));
         parser.process(qapp);
 
+        if (parser.isSet(opt_q))
+            try {
+                QList<QByteArray> messages;
+                for (const auto &query : parser.values(opt_q))
+                {
+                    QStringList args{"query"};
+                    if (!parser.isSet(opt_s))
+                        args << "--json";
+                    args << query;
+                    messages << QJsonDocument(QJsonArray::fromStringList(args)).toJson(QJsonDocument::Compact);
+                }
+
+                // Queries are pipelined. Print the responses in order.
+                vector<QByteArray> buffers(messages.size());
+                vector<bool> complete(messages.size(), false);
+                qsizetype current = 0;
+                RPCServer::sendMessages(messages, [&](qsizetype i, const QByteArray &chunk, bool final){
+                    if (i < current || i >= messages.size())
+                        return;
+                    else if (i == current)
+                        cout << chunk.data() << flush;
+                    else
+                        buffers[i] += chunk;
+
+                    complete[i] = final;
+                    while (current < messages.size() && complete[current])
+                        if (++current < messages.size())
+                            cout << exchange(buffers[current], {}).data() << flush;
+                });
+                return EXIT_SUCCESS;
+            } catch (const exception &e) {
+                cout << e.what() << endl;
+                return EXIT_FAILURE;
+            }
+
         // TODO If not running? Continue and use? Makes sense for albert show but not for URLs.
         if (const auto args = parser.positionalArguments(); !args.isEmpty())
             try {
                 QJsonDocument d(QJsonArray::fromStringList(args));
-                auto bytes = d.toJson(QJsonDocument::Compact);
-                bytes = RPCServer::sendMessage(bytes);
-                cout << bytes.data() << endl;
+                bool line_open = false;
+                RPCServer::sendMessage(d.toJson(QJsonDocument::Compact),
+                                       [&](const QByteArray &chunk){
+                                           cout << chunk.data() << flush;
+                                           line_open = !chunk.endsWith('\n');
+                                       });
+                if (line_open)
+                    cout << endl;
                 return EXIT_SUCCESS;
             } catch (const exception &e) {
                 cout << e.what() << endl;
@@ -0,0 +1,109 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#include "logging.h"
+#include "pluginmetadatacache.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QPluginLoader>
+#include <QSaveFile>
+#if defined(Q_OS_UNIX)
+#include <sys/stat.h>
+#endif
+using namespace std::chrono;
+using namespace std;
+
+static const int cache_version = 1;
+
+static const QString &key_version     = QStringLiteral("version");
+static const QString &key_entries     = QStringLiteral("entries");
+static const QString &key_size        = QStringLiteral("size");
+static const QString &key_mtime       = QStringLiteral("mtime");
+static const QString &key_inode       = QStringLiteral("inode");
+static const QString &key_parse_time  = QStringLiteral("parse_time_us");
+static const QString &key_metadata    = QStringLiteral("metadata");
+
+/// Returns the file properties validating a cache entry.
+static QJsonObject fileStamp(const QFileInfo &fi)
+{
+    qint64 inode = 0;
+#if defined(Q_OS_UNIX)
+    if (struct stat st; ::stat(QFile::encodeName(fi.filePath()).constData(), &st) == 0)
+        inode = (qint64)st.st_ino;
+#endif
+    return {
+        {key_size, fi.size()},
+        {key_mtime, fi.lastModified().toMSecsSinceEpoch()},
+        {key_inode, QString::number(inode)}  // JSON numbers are doubles
+    };
+}
+
+PluginMetaDataCache::PluginMetaDataCache(const QString &path) : path_(path)
+{
+    if (QFile f(path_); f.open(QIODevice::ReadOnly))
+    {
+        const auto object = QJsonDocument::fromJson(f.readAll()).object();
+        if (object[key_version].toInt() == cache_version)
+            entries_ = object[key_entries].toObject();
+        else
+            DEBG << "Plugin metadata cache version mismatch. Rebuilding.";
+    }
+}
+
+PluginMetaDataCache::~PluginMetaDataCache()
+{
+    if (misses_ == 0 && used_entries_.size() == entries_.size())
+        return;  // unchanged
+
+    QDir().mkpath(QFileInfo(path_).path());
+
+    QSaveFile f(path_);
+    if (f.open(QIODevice::WriteOnly))
+    {
+        f.write(QJsonDocument(QJsonObject{{key_version, cache_version},
+                                          {key_entries, used_entries_}}).toJson(QJsonDocument::Compact));
+        if (!f.commit())
+            WARN << "Failed writing plugin metadata cache:" << f.errorString();
+    }
+    else
+        WARN << "Failed opening plugin metadata cache for writing:" << f.errorString();
+}
+
+QJsonObject PluginMetaDataCache::metaData(const QString &path)
+{
+    const QFileInfo fi(path);
+    const auto canonical_path = fi.canonicalFilePath();
+    auto stamp = fileStamp(fi);
+
+    if (const auto entry = entries_.value(canonical_path).toObject();
+        entry[key_size] == stamp[key_size]
+        && entry[key_mtime] == stamp[key_mtime]
+        && entry[key_inode] == stamp[key_inode])
+    {
+        ++hits_;
+        time_saved_ += microseconds(entry[key_parse_time].toInteger());
+        used_entries_.insert(canonical_path, entry);
+        return entry[key_metadata].toObject();
+    }
+
+    ++misses_;
+    const auto tp = steady_clock::now();
+    auto metadata = QPluginLoader(path).metaData();
+    const auto dur = duration_cast<microseconds>(steady_clock::now() - tp);
+    time_spent_ += dur;
+
+    stamp.insert(key_parse_time, dur.count());
+    stamp.insert(key_metadata, metadata);
+    used_entries_.insert(canonical_path, stamp);
+    return metadata;
+}
+
+uint PluginMetaDataCache::hits() const { return hits_; }
+
+uint PluginMetaDataCache::misses() const { return misses_; }
+
+microseconds PluginMetaDataCache::timeSaved() const { return time_saved_; }
+
+microseconds PluginMetaDataCache::timeSpent() const { return time_spent_; }
@@ -0,0 +1,47 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#pragma once
+#include <QJsonObject>
+#include <QString>
+#include <chrono>
+
+///
+/// Persistent cache of the raw metadata of native plugin files.
+///
+/// Reading the metadata embedded in a shared object requires opening and parsing the file.
+/// This cache stores the result per canonical file path, validated by the size, modification
+/// time and inode of the file. Files that are not plugins are cached as well (empty metadata).
+///
+class PluginMetaDataCache
+{
+public:
+
+    /// Reads the cache from `path`.
+    explicit PluginMetaDataCache(const QString &path);
+
+    /// Writes the cache if it changed. Drops entries that have not been used.
+    ~PluginMetaDataCache();
+
+    /// Returns the raw metadata of the plugin file at `path`. Reads the file on cache misses.
+    QJsonObject metaData(const QString &path);
+
+    uint hits() const;
+    uint misses() const;
+
+    /// The time it took to read the metadata of the cache hits when they were read.
+    std::chrono::microseconds timeSaved() const;
+
+    /// The time spent reading metadata of cache misses.
+    std::chrono::microseconds timeSpent() const;
+
+private:
+
+    QString path_;
+    QJsonObject entries_;
+    QJsonObject used_entries_;
+    uint hits_ = 0;
+    uint misses_ = 0;
+    std::chrono::microseconds time_saved_{0};
+    std::chrono::microseconds time_spent_{0};
+
+};
@@ -150,11 +150,11 @@ QString PluginQueryHandler::defaultTrigger() const
 
 void PluginQueryHandler::updateIndexItems()
 {
-    vector<IndexItem> items;
+    auto builder = indexBuilder();
     for (auto &[id, plugin] : plugin_registry_.plugins()){
         auto item = make_shared<PluginItem>(plugin_registry_, plugin);
-        items.emplace_back(item, id);
-        items.emplace_back(item, plugin.metaData().name);
+        builder.add(item, id);
+        builder.add(item, plugin.metaData().name);
     }
-    setIndexItems(::move(items));
+    builder.commit();
 }
@@ -5,10 +5,8 @@
 #include "plugininstance.h"
 #include "qtpluginloader.h"
 #include <QCoreApplication>
-#include <QFutureWatcher>
 #include <QPluginLoader>
 #include <QTranslator>
-#include <QtConcurrentRun>
 using namespace albert;
 using namespace std;
 
@@ -29,13 +27,16 @@ static QString fetchLocalizedMetadata(const QJsonObject &json ,const QString &ke
 }
 
 
-QtPluginLoader::QtPluginLoader(const QString &p) : loader_(p), instance_(nullptr)
+QtPluginLoader::QtPluginLoader(const QString &p) : QtPluginLoader(p, QPluginLoader(p).metaData()) {}
+
+QtPluginLoader::QtPluginLoader(const QString &p, const QJsonObject &rawMetaData) :
+    path_(p), instance_(nullptr)
 {
     //
     // Check interface
     //
 
-    auto iid = loader_.metaData()[QStringLiteral("IID")].toString();
+    auto iid = rawMetaData[QStringLiteral("IID")].toString();
 
     if (iid.isEmpty())
         throw runtime_error("Not a Qt plugin");
@@ -85,10 +86,11 @@ QtPluginLoader::QtPluginLoader(const QString &p) : loader_(p), instance_(nullptr
     const QString key_plugin_dependencies = QStringLiteral("plugin_dependencies");
     const QString key_credits = QStringLiteral("credits");
     const QString key_load_type = QStringLiteral("loadtype");
+    const QString key_lazy_activation = QStringLiteral("lazy_activation");
     const QString load_type_frontend = QStringLiteral("frontend");
     const QString load_type_user = QStringLiteral("user");
 
-    auto rawMetadata = loader_.metaData()[key_md].toObject();
+    auto rawMetadata = rawMetaData[key_md].toObject();
 
     auto load_type = PluginMetaData::LoadType::User;
     if (auto lts = rawMetadata[key_load_type].toString(); lts == load_type_frontend)
@@ -112,90 +114,64 @@ QtPluginLoader::QtPluginLoader(const QString &p) : loader_(p), instance_(nullptr
         .plugin_dependencies = rawMetadata[key_plugin_dependencies].toVariant().toStringList(),
         .third_party_credits = rawMetadata[key_credits].toVariant().toStringList(),
         .platforms{},
-        .load_type = load_type
+        .load_type = load_type,
+        .lazy_activation = rawMetadata[key_lazy_activation].toBool()
     };
-
-    //
-    // Set load hints
-    //
-    // ExportExternalSymbolsHint:
-    // Some python libs do not link against python. Export the python symbols to the main app.
-    // (this comment is like 10y old, TODO check if necessary)
-    //
-    // PreventUnloadHint:
-    // To be able to unload we have to make sure that there is no object of this library alive.
-    // This is nearly impossible with the current design. Frontends keep queries alive over
-    // sessions which then segfault on deletion when the code has been unloaded.
-    //
-    // TODO: Design something that ensures that no items/actions will be alive when plugins get
-    // unloaded. (e.g. Session class, owning queries, injected into frontends when shown).
-    //
-    // Anyway atm frontends keep queries alive over session, which is just poor design.
-    // However not unloading is an easy fix for now and theres more important stuff to do.
-    //
-    // Update 2024:
-    //
-    // Althought the design _does_ handle object lifetime correctly now the app still segfaults
-    // when unloading plugins. Probably due to qt internal connection handling. One example that
-    // proved to sefault guaranteed is the WeakDependency class whose connections (at least on
-    // macos) call into unloaded code although all connections have been properly disconnected.
-    //
-    // Probably this should be reported as a bug to Qt. But well, … PreventUnload
-    //
-
-    loader_.setLoadHints(QLibrary::ExportExternalSymbolsHint | QLibrary::PreventUnloadHint);
 }
 
 QtPluginLoader::~QtPluginLoader()
 {
-    if (loader_.isLoaded())
+    if (loader_ && loader_->isLoaded())
     {
         CRIT << "QtPluginLoader destroyed in loaded state:" << metadata_.id;
         QtPluginLoader::unload();
     }
 }
 
-QString QtPluginLoader::path() const { return loader_.fileName(); }
+QString QtPluginLoader::path() const { return path_; }
 
 const PluginMetaData &QtPluginLoader::metaData() const { return metadata_; }
 
 void QtPluginLoader::load()
 {
-    QFutureWatcher<void> watcher;
-    watcher.setFuture(QtConcurrent::run([this]{
-        if (!loader_.load())
-            throw runtime_error(loader_.errorString().toStdString());
-    }));
-
-    try{
-        QEventLoop loop;
-        QObject::connect(&watcher, &decltype(watcher)::finished, &loop, &QEventLoop::quit);
-        loop.exec();
-        watcher.future().waitForFinished();
-
-        translator = make_unique<QTranslator>();
-        if (translator->load(QLocale(), metaData().id, "_", ":/i18n"))
-        {
-            DEBG << QString("Using translations for '%1' from %2").arg(metadata_.id,
-                                                                       translator->filePath());
-            QCoreApplication::installTranslator(translator.get());
-        }
-        else
-            translator.reset();
-    }
-    catch (const QUnhandledException &e)
+    // Called in a background thread, possibly concurrently with other loaders.
+    // Created lazily, since QPluginLoader parses the metadata of the file on construction.
+    if (!loader_)
     {
-        if (e.exception())
-            std::rethrow_exception(e.exception());
-        else {
-            CRIT << "QUnhandledException but exception() returns nullptr";
-            throw;
-        }
-    }
-    catch (...)
-    {
-        CRIT << "Unknown exception in QtPluginLoader::load()";
+        loader_ = make_unique<QPluginLoader>(path_);
+
+        //
+        // Set load hints
+        //
+        // ExportExternalSymbolsHint:
+        // Some python libs do not link against python. Export the python symbols to the main app.
+        // (this comment is like 10y old, TODO check if necessary)
+        //
+        // PreventUnloadHint:
+        // To be able to unload we have to make sure that there is no object of this library alive.
+        // This is nearly impossible with the current design. Frontends keep queries alive over
+        // sessions which then segfault on deletion when the code has been unloaded.
+        //
+        // TODO: Design something that ensures that no items/actions will be alive when plugins get
+        // unloaded. (e.g. Session class, owning queries, injected into frontends when shown).
+        //
+        // Anyway atm frontends keep queries alive over session, which is just poor design.
+        // However not unloading is an easy fix for now and theres more important stuff to do.
+        //
+        // Update 2024:
+        //
+        // Althought the design _does_ handle object lifetime correctly now the app still segfaults
+        // when unloading plugins. Probably due to qt internal connection handling. One example that
+        // proved to sefault guaranteed is the WeakDependency class whose connections (at least on
+        // macos) call into unloaded code although all connections have been properly disconnected.
+        //
+        // Probably this should be reported as a bug to Qt. But well, … PreventUnload
+        //
+        loader_->setLoadHints(QLibrary::ExportExternalSymbolsHint | QLibrary::PreventUnloadHint);
     }
+
+    if (!loader_->load())
+        throw runtime_error(loader_->errorString().toStdString());
 }
 
 void QtPluginLoader::unload()
@@ -207,17 +183,31 @@ void QtPluginLoader::unload()
     }
 
     instance_ = nullptr;
-    if (!loader_.unload())
-        throw runtime_error(loader_.errorString().toStdString());
+    if (loader_ && !loader_->unload())
+        throw runtime_error(loader_->errorString().toStdString());
 }
 
 PluginInstance *QtPluginLoader::createInstance()
 {
-    if (loader_.isLoaded())
+    if (loader_ && loader_->isLoaded())
     {
         if (!instance_)
         {
-            auto *instance = loader_.instance();
+            // Translators have to be installed in the main thread
+            if (!translator)
+            {
+                translator = make_unique<QTranslator>();
+                if (translator->load(QLocale(), metaData().id, "_", ":/i18n"))
+                {
+                    DEBG << QString("Using translations for '%1' from %2").arg(metadata_.id,
+                                                                               translator->filePath());
+                    QCoreApplication::installTranslator(translator.get());
+                }
+                else
+                    translator.reset();
+            }
+
+            auto *instance = loader_->instance();
             instance_ = dynamic_cast<PluginInstance*>(instance);
             if (!instance_)
                 throw runtime_error("Plugin instance is not of type albert::PluginInstance.");
@@ -11,7 +11,11 @@ class QtPluginLoader : public albert::PluginLoader
 {
 public:
 
+    /// Reads the metadata from the library at `path`.
     QtPluginLoader(const QString &path);
+
+    /// Uses `rawMetaData` as obtained by QPluginLoader::metaData() instead of reading the library.
+    QtPluginLoader(const QString &path, const QJsonObject &rawMetaData);
     ~QtPluginLoader();
 
     QString path() const override;
@@ -22,7 +26,8 @@ public:
 
 private:
 
-    QPluginLoader loader_;
+    QString path_;
+    std::unique_ptr<QPluginLoader> loader_;
     albert::PluginMetaData metadata_;
     albert::PluginInstance *instance_;
     std::unique_ptr<QTranslator> translator;
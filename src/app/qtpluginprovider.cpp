@@ -1,6 +1,8 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
+#include "albert.h"
 #include "logging.h"
+#include "pluginmetadatacache.h"
 #include "qtpluginloader.h"
 #include "qtpluginprovider.h"
 #include <QCoreApplication>
@@ -43,13 +45,16 @@ QtPluginProvider::QtPluginProvider(QStringList paths)
             unique_canonical_paths << pfi.canonicalFilePath();
     unique_canonical_paths.removeDuplicates();
 
+    PluginMetaDataCache cache(QString::fromStdString((cacheLocation() / "plugin_metadata.json").string()));
+
     INFO << "Searching native plugins in" << unique_canonical_paths.join(", ");
     for (const auto &path : unique_canonical_paths)
     {
         QDirIterator dirIterator(path, QDir::Files);
         while (dirIterator.hasNext()) {
             try {
-                auto pl = make_unique<QtPluginLoader>(QFileInfo(dirIterator.next()).absoluteFilePath());
+                const auto file_path = QFileInfo(dirIterator.next()).absoluteFilePath();
+                auto pl = make_unique<QtPluginLoader>(file_path, cache.metaData(file_path));
                 DEBG << "Found valid native plugin" << pl->path();
                 plugin_loaders_.emplace_back(::move(pl));
             } catch (const runtime_error &e) {
@@ -57,6 +62,11 @@ QtPluginProvider::QtPluginProvider(QStringList paths)
             }
         }
     }
+
+    INFO << QString("Plugin metadata cache: %1 hits, %2 misses. Saved %3 ms, spent %4 ms reading metadata.")
+                .arg(cache.hits()).arg(cache.misses())
+                .arg(cache.timeSaved().count() / 1000.0, 0, 'f', 1)
+                .arg(cache.timeSpent().count() / 1000.0, 0, 'f', 1);
 }
 
 QtPluginProvider::~QtPluginProvider() = default;
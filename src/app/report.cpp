@@ -1,5 +1,7 @@
 // Copyright (c) 2023-2024 Manuel Schneider
 
+#include "pixmapcache.h"
+#include "querystatistics.h"
 #include <QApplication>
 #include <QDir>
 #include <QFont>
@@ -49,6 +51,31 @@ QStringList report()
     sl << fn("Working dir",           QDir::currentPath());
     sl << fn("Arguments",             QApplication::arguments().join(" "));
 
+    // CACHES
+    const auto pcs = PixmapCache::instance().statistics();
+    sl << fn("Pixmap cache",          QString("%1 entries, %2/%3 KiB, %4 hits, %5 misses, "
+                                              "%6 shared, %7 evictions")
+                                          .arg(pcs.entries).arg(pcs.bytes / 1024)
+                                          .arg(pcs.capacity / 1024).arg(pcs.hits)
+                                          .arg(pcs.misses).arg(pcs.shared).arg(pcs.evictions));
+
+    // QUERY STATISTICS, percentiles p50/p95/p99
+    const auto &qs = QueryStatistics::instance();
+    sl << "QUERY STATISTICS (p50/p95/p99):";
+    sl << fn("Time to first result", QString("%1, %2 queries")
+                                          .arg(QueryStatistics::latencySummary(qs.timeToFirstResult()))
+                                          .arg(qs.timeToFirstResult().count()));
+    for (const auto &[id, s] : qs.handlers())
+    {
+        auto value = QString("handling %1, results %2, %3 queries")
+                         .arg(QueryStatistics::latencySummary(s->handling),
+                              QueryStatistics::countSummary(s->results))
+                         .arg(s->handling.count());
+        if (s->scoring.count() > 0)
+            value += QString(", scoring %1").arg(QueryStatistics::latencySummary(s->scoring));
+        sl << fn(id, value);
+    }
+
     // ENVIRONMENT
     sl << "ENVIRONMENT:";
     auto env = QProcessEnvironment::systemEnvironment();
@@ -5,33 +5,229 @@
 #include "rpcserver.h"
 #include <QDir>
 #include <QFile>  // QtPrivate::fromFilesystemPath
+#include <QJsonDocument>
 #include <QLocalServer>
 #include <QLocalSocket>
+#include <QPointer>
+#include <QTimer>
+#include <QtEndian>
+#include <utility>
 using namespace albert;
 using namespace std;
 
+static const qsizetype max_payload_size = 16 * 1024 * 1024;
+static const qsizetype request_header_size = 8;
+static const qsizetype response_header_size = 9;
+static const int response_timeout = 10000;  // ms, between two frames
+static const int idle_timeout = 10000;  // ms, between two pieces of an incomplete message
+
 static QString socketPath()
 { return QtPrivate::fromFilesystemPath(cacheLocation() / "ipc_socket"); }
 
+static QByteArray requestFrame(quint32 id, const QByteArray &payload)
+{
+    QByteArray frame(request_header_size, Qt::Uninitialized);
+    qToBigEndian<quint32>(payload.size(), frame.data());
+    qToBigEndian<quint32>(id, frame.data() + 4);
+    return frame.append(payload);
+}
+
+static QByteArray responseFrame(quint32 id, bool final, const QByteArray &payload)
+{
+    QByteArray frame(response_header_size, Qt::Uninitialized);
+    qToBigEndian<quint32>(payload.size(), frame.data());
+    qToBigEndian<quint32>(id, frame.data() + 4);
+    frame[8] = final ? 1 : 0;
+    return frame.append(payload);
+}
+
+
+class RPCServer::Response::Private
+{
+public:
+    QPointer<QLocalSocket> socket;
+    const quint32 id;
+    const bool legacy;
+    bool closed = false;
+    QByteArray legacy_buffer;
+
+    Private(QLocalSocket *s, quint32 i, bool l) : socket(s), id(i), legacy(l) {}
+    ~Private() { close({}); }
+
+    bool isOpen() const
+    { return !closed && socket && socket->state() == QLocalSocket::ConnectedState; }
+
+    void write(const QByteArray &chunk)
+    {
+        if (!isOpen())
+            return;
+        else if (legacy)
+            legacy_buffer.append(chunk);
+        else if (!chunk.isEmpty())
+            socket->write(responseFrame(id, false, chunk));
+    }
+
+    void close(const QByteArray &chunk)
+    {
+        if (!isOpen())
+            return;
+
+        closed = true;
+        if (legacy)
+        {
+            socket->write(legacy_buffer.append(chunk));
+            socket->disconnectFromServer();
+        }
+        else
+            socket->write(responseFrame(id, true, chunk));
+    }
+};
+
+void RPCServer::Response::write(const QByteArray &chunk) const { d->write(chunk); }
+
+void RPCServer::Response::close(const QByteArray &chunk) const { d->close(chunk); }
+
+bool RPCServer::Response::isOpen() const { return d->isOpen(); }
+
+
+bool RPCServer::RequestParser::parse(const QByteArray &bytes, vector<Request> &requests)
+{
+    buffer_.append(bytes);
+
+    // Legacy clients send a bare JSON array. Framed messages never start with '[' since the
+    // size would exceed the maximum payload size.
+    if (buffer_.startsWith('['))
+    {
+        // Scan for the end of the array, the message is parsed once it is complete
+        for (; scanned_ < buffer_.size(); ++scanned_)
+        {
+            const char c = buffer_[scanned_];
+            if (in_string_)
+            {
+                if (escaped_)
+                    escaped_ = false;
+                else if (c == '\\')
+                    escaped_ = true;
+                else if (c == '"')
+                    in_string_ = false;
+            }
+            else if (c == '"')
+                in_string_ = true;
+            else if (c == '[' || c == '{')
+                ++depth_;
+            else if ((c == ']' || c == '}') && --depth_ == 0)
+            {
+                auto message = buffer_.left(scanned_ + 1);
+                QJsonParseError error;
+                QJsonDocument::fromJson(message, &error);
+                if (error.error != QJsonParseError::NoError)
+                    return fail("Invalid legacy message.");
+
+                requests.push_back({0, ::move(message), true});
+                reset();  // legacy clients are disconnected after the response
+                return true;
+            }
+        }
+
+        if (buffer_.size() > max_payload_size)
+            return fail("Invalid legacy message.");
+        return true;  // wait for the rest of the message
+    }
+
+    while (buffer_.size() >= request_header_size)
+    {
+        const qsizetype size = qFromBigEndian<quint32>(buffer_.constData());
+        if (size > max_payload_size)
+            return fail("Message exceeds the maximum size.");
+
+        if (buffer_.size() < request_header_size + size)
+            break;  // wait for the rest of the frame
+
+        const auto id = qFromBigEndian<quint32>(buffer_.constData() + 4);
+        requests.push_back({id, buffer_.mid(request_header_size, size), false});
+        buffer_.remove(0, request_header_size + size);
+    }
+
+    return true;
+}
+
+bool RPCServer::RequestParser::isPending() const { return !buffer_.isEmpty(); }
+
+const char *RPCServer::RequestParser::error() const { return error_; }
+
+bool RPCServer::RequestParser::fail(const char *reason)
+{
+    error_ = reason;
+    reset();
+    return false;
+}
+
+void RPCServer::RequestParser::reset()
+{
+    buffer_.clear();
+    scanned_ = 0;
+    depth_ = 0;
+    in_string_ = false;
+    escaped_ = false;
+}
+
+
 class RPCServer::Private
 {
 public:
     QLocalServer local_server;
-    function<QByteArray(const QByteArray&)> handler;
+    MessageHandler handler;
 
     void onConnection()
     {
-        QLocalSocket* socket = local_server.nextPendingConnection();
-        socket->waitForReadyRead(50);
-        if (socket->bytesAvailable())
+        while (auto *socket = local_server.nextPendingConnection())
         {
-            if (handler)
-                socket->write(handler(socket->readAll()));
+            // Disconnect clients not completing a started message
+            auto *idle_timer = new QTimer(socket);
+            idle_timer->setSingleShot(true);
+            idle_timer->setInterval(idle_timeout);
+            QObject::connect(idle_timer, &QTimer::timeout, socket,
+                             [socket]{ reject(socket, "Incomplete message timed out."); });
 
+            QObject::connect(socket, &QLocalSocket::readyRead, socket,
+                             [this, socket, idle_timer, parser = RequestParser()]() mutable
+                             { onReadyRead(socket, parser, idle_timer); });
+            QObject::connect(socket, &QLocalSocket::disconnected,
+                             socket, &QObject::deleteLater);
         }
-        socket->flush();
-        socket->close();
-        socket->deleteLater();
+    }
+
+    void onReadyRead(QLocalSocket *socket, RequestParser &parser, QTimer *idle_timer)
+    {
+        vector<RequestParser::Request> requests;
+        const auto valid = parser.parse(socket->readAll(), requests);
+
+        for (auto &request : requests)
+        {
+            dispatch(::move(request.payload), socket, request.id, request.legacy);
+            if (socket->state() != QLocalSocket::ConnectedState)
+                return;
+        }
+
+        if (!valid)
+            reject(socket, parser.error());
+        else if (parser.isPending())
+            idle_timer->start();
+        else
+            idle_timer->stop();
+    }
+
+    void dispatch(QByteArray message, QLocalSocket *socket, quint32 id, bool legacy)
+    {
+        Response response{make_shared<Response::Private>(socket, id, legacy)};
+        if (handler)
+            handler(message, ::move(response));
+    }
+
+    static void reject(QLocalSocket *socket, const char *reason)
+    {
+        WARN << "Rejecting RPC client:" << reason;
+        socket->disconnectFromServer();
     }
 };
 
@@ -79,27 +275,70 @@ RPCServer::~RPCServer()
     d->local_server.close();
 }
 
-void RPCServer::setMessageHandler(function<QByteArray(const QByteArray &)> h){ d->handler = h; }
+void RPCServer::setMessageHandler(MessageHandler h) { d->handler = ::move(h); }
 
 QByteArray RPCServer::sendMessage(const QByteArray &bytes, bool await_response)
+{
+    if (!await_response)
+    {
+        QLocalSocket socket;
+        socket.connectToServer(socketPath());
+        if (!socket.waitForConnected(500))
+            throw runtime_error("Failed to connect to albert.");
+        socket.write(requestFrame(0, bytes));
+        socket.waitForBytesWritten(1000);
+        return {};
+    }
+
+    QByteArray response;
+    sendMessage(bytes, [&](const QByteArray &chunk){ response.append(chunk); });
+    return response;
+}
+
+void RPCServer::sendMessage(const QByteArray &bytes, const function<void(const QByteArray &)> &onChunk)
+{
+    sendMessages({bytes}, [&](qsizetype, const QByteArray &chunk, bool)
+                 { if (!chunk.isEmpty()) onChunk(chunk); });
+}
+
+void RPCServer::sendMessages(const QList<QByteArray> &messages,
+                             const function<void(qsizetype, const QByteArray &, bool)> &onChunk)
 {
     QLocalSocket socket;
     socket.connectToServer(socketPath());
-    if (socket.waitForConnected(500))
+    if (!socket.waitForConnected(500))
+        throw runtime_error("Failed to connect to albert.");
+
+    for (qsizetype i = 0; i < messages.size(); ++i)
+        socket.write(requestFrame(i, messages[i]));
+    socket.flush();
+
+    QByteArray buffer;
+    auto pending = messages.size();
+    while (pending > 0)
     {
-        socket.write(bytes);
-        socket.flush();
+        while (buffer.size() >= response_header_size)
+        {
+            const qsizetype size = qFromBigEndian<quint32>(buffer.constData());
+            if (buffer.size() < response_header_size + size)
+                break;
 
-        if(!await_response)
-            return {};
+            const auto id = qFromBigEndian<quint32>(buffer.constData() + 4);
+            const bool is_final = buffer[8];
+            onChunk(id, buffer.mid(response_header_size, size), is_final);
+            buffer.remove(0, response_header_size + size);
 
-        if (socket.waitForReadyRead(1000))
-            return socket.readAll();
+            if (is_final)
+                --pending;
+        }
+
+        if (pending == 0)
+            return;
+        else if (socket.waitForReadyRead(response_timeout))
+            buffer.append(socket.readAll());
         else if (auto e = socket.error(); e == QLocalSocket::PeerClosedError)
-            return {};
+            return;
         else
             throw runtime_error(socket.errorString().toStdString());
     }
-    else
-        throw runtime_error("Failed to connect to albert.");
 }
@@ -1,22 +1,121 @@
 // Copyright (C) 2022-2025 Manuel Schneider
 
 #pragma once
+#include <QByteArray>
+#include <QList>
 #include <functional>
 #include <memory>
+#include <vector>
 namespace albert { class ExtensionRegistry; }
-class QByteArray;
 
+///
+/// Local IPC server.
+///
+/// Clients keep their connection open and may send any number of requests without waiting for
+/// the responses (pipelining). Messages are framed:
+///
+///     request:  quint32 payload size | quint32 request id | payload
+///     response: quint32 payload size | quint32 request id | quint8 final | payload
+///
+/// All integers are big endian. A request is answered by one or more response frames carrying
+/// its id, the last one having `final` set. Responses of different requests may interleave.
+///
+/// Clients sending a bare, unframed message (legacy protocol) get a bare response and are
+/// disconnected. Clients that do not complete a started message in time are disconnected.
+///
 class RPCServer
 {
 public:
 
+    ///
+    /// The response to a request.
+    ///
+    /// Copyable handle. Has to be used in the main thread. Closes the response if the last copy
+    /// is destroyed. Writes to responses of disconnected clients are discarded.
+    ///
+    class Response
+    {
+    public:
+
+        /// Sends `chunk` as part of the response. Not supported by the legacy protocol, chunks
+        /// are collected and sent on close.
+        void write(const QByteArray &chunk) const;
+
+        /// Sends `chunk` as final part of the response. Further writes are discarded.
+        void close(const QByteArray &chunk = {}) const;
+
+        /// Returns true if the response is not closed and the client is still connected.
+        bool isOpen() const;
+
+        class Private;
+        std::shared_ptr<Private> d;
+
+    };
+
+    ///
+    /// Incremental parser of the request stream of a connection.
+    ///
+    /// Every byte is scanned once, also the ones of legacy messages arriving in pieces.
+    ///
+    class RequestParser
+    {
+    public:
+
+        struct Request
+        {
+            quint32 id;
+            QByteArray payload;
+            bool legacy;
+        };
+
+        /// Consumes `bytes` and appends the completed requests to `requests`.
+        /// Returns false if the stream is invalid, see error(). Drops the buffered data then.
+        bool parse(const QByteArray &bytes, std::vector<Request> &requests);
+
+        /// Returns true if a started request is not complete yet.
+        bool isPending() const;
+
+        /// The reason of the last failure.
+        const char *error() const;
+
+    private:
+
+        bool fail(const char *reason);
+        void reset();
+
+        QByteArray buffer_;
+        const char *error_ = nullptr;
+
+        // Legacy JSON scan state
+        qsizetype scanned_ = 0;
+        int depth_ = 0;
+        bool in_string_ = false;
+        bool escaped_ = false;
+
+    };
+
+    using MessageHandler = std::function<void(const QByteArray &message, Response response)>;
+
     RPCServer();
     ~RPCServer();
 
-    void setMessageHandler(std::function<QByteArray(const QByteArray&)> handler);
+    void setMessageHandler(MessageHandler handler);
 
+    /// Sends `bytes` to the running instance and returns the response.
     static QByteArray sendMessage(const QByteArray &bytes, bool await_response = true);
 
+    /// Sends `bytes` to the running instance and calls `onChunk` for every part of the response.
+    static void sendMessage(const QByteArray &bytes,
+                            const std::function<void(const QByteArray &chunk)> &onChunk);
+
+    /// Sends `messages` pipelined on a single connection and calls `onChunk` for every part of
+    /// the responses. `index` is the index of the message the chunk belongs to. Responses may
+    /// interleave. Returns when all responses are complete.
+    static void sendMessages(const QList<QByteArray> &messages,
+                             const std::function<void(qsizetype index,
+                                                      const QByteArray &chunk,
+                                                      bool final)> &onChunk);
+
 private:
 
     class Private;
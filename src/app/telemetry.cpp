@@ -6,6 +6,7 @@
 #include "logging.h"
 #include "networkutil.h"
 #include "pluginregistry.h"
+#include "settingsstore.h"
 #include "telemetry.h"
 #include "telemetryprovider.h"
 #include "usagedatabase.h"
@@ -17,20 +18,20 @@
 #include <QMessageBox>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
-#include <QSettings>
 #include <QTimeZone>
 static const char *CFG_LAST_REPORT = "last_report";
 static const char *CFG_TELEMETRY_ENABLED = "telemetry";
+using namespace albert::util;
 using namespace albert;
 
 
 Telemetry::Telemetry(albert::ExtensionRegistry &registry):
     registry_(registry),
-    last_report(state()->value(CFG_LAST_REPORT,  // Default to -24h avoid sending old data
+    last_report(SettingsStore::state().value(CFG_LAST_REPORT,  // Default to -24h avoid sending old data
                                QDateTime::currentDateTime().addDays(-1)).toDateTime())
 {
-    if (auto s = settings(); s->contains(CFG_TELEMETRY_ENABLED))
-        enabled_ = s->value(CFG_TELEMETRY_ENABLED).toBool();
+    if (auto &s = SettingsStore::config(); s.contains(CFG_TELEMETRY_ENABLED))
+        enabled_ = s.value(CFG_TELEMETRY_ENABLED).toBool();
     else
     {
         auto text = tr(
@@ -55,7 +56,7 @@ Telemetry::Telemetry(albert::ExtensionRegistry &registry):
         mb.setDefaultButton(MB::Yes);
         const auto enable = MB::Yes == mb.exec();
         enabled_ = enable;
-        settings()->setValue(CFG_TELEMETRY_ENABLED, enable);
+        SettingsStore::config().setValue(CFG_TELEMETRY_ENABLED, enable);
     }
 
     QObject::connect(&timer, &QTimer::timeout,
@@ -90,7 +91,7 @@ void Telemetry::trySendReport()
         {
             INFO << "Successfully sent telemetry data.";
             last_report = now;
-            state()->setValue(CFG_LAST_REPORT, last_report);
+            SettingsStore::state().setValue(CFG_LAST_REPORT, last_report);
         }
         else
         {
@@ -174,6 +175,6 @@ void Telemetry::setEnabled(bool value)
     if (enabled_ != value)
     {
         enabled_ = value;
-        settings()->setValue(CFG_TELEMETRY_ENABLED, enabled_);
+        SettingsStore::config().setValue(CFG_TELEMETRY_ENABLED, enabled_);
     }
 }
@@ -4,6 +4,7 @@
 #include "queryengine.h"
 #include "queryexecution.h"
 #include "session.h"
+#include "trace.h"
 using namespace albert;
 using namespace std;
 
@@ -27,6 +28,8 @@ Session::~Session()
 
 void Session::runQuery(const QString &query_string)
 {
+    TraceSpan span("Session::runQuery", query_string);
+
     if(!queries_.empty())
         queries_.back()->cancel();
 
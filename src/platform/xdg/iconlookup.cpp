@@ -2,21 +2,66 @@
 
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
-#include <QIcon>
 #include <QStandardPaths>
 #include <QString>
-#include "themefileparser.h"
+#include "albert.h"
 #include "iconlookup.h"
+#include "themeindex.h"
+#include <limits>
 using namespace std;
 
 namespace  {
-    QStringList icon_extensions = {"png", "svg", "xpm"};
+    const QStringList &icon_extensions = XDG::ThemeIndex::extensions();
 }
 
-QString XDG::IconLookup::iconPath(QString iconName, QSize , QString themeName)  // FIXME unused qsize
+QString XDG::IconLookup::iconPath(QString iconName, QSize size, QString themeName)
 {
-    return instance()->themeIconPath(iconName, themeName);
+    return instance().themeIconPath(iconName, size.isValid() ? qMax(size.width(), size.height()) : 0, themeName);
+}
+
+/// Returns the file of `iconName` in `index` best matching `size`, nullptr if there is none.
+/// See https://specifications.freedesktop.org/icon-theme-spec/latest/#icon_lookup
+static const XDG::ThemeIndex::File *bestFile(const XDG::ThemeIndex &index, const QString &iconName, int size)
+{
+    using File = XDG::ThemeIndex::File;
+    const auto &dirs = index.directories();
+    const auto pixels = [&](const File &f){ return dirs[f.directory].size * dirs[f.directory].scale; };
+    const File *best = nullptr;
+
+    if (size <= 0)  // No size requested, take the largest
+    {
+        for (const auto &file : index.files(iconName))
+            if (!best || pixels(file) > pixels(*best))
+                best = &file;
+        return best;
+    }
+
+    // Exact match. Prefer scalable svgs, they render sharp at any size.
+    for (const auto &file : index.files(iconName))
+        if (const auto &dir = dirs[file.directory]; dir.matchesSize(size))
+        {
+            if (dir.type == QStringLiteral("Scalable") && file.path.endsWith(QStringLiteral(".svg")))
+                return &file;
+            else if (!best)
+                best = &file;
+        }
+
+    if (best)
+        return best;
+
+    // Closest match. Prefer larger icons on ties, downscaling looks better than upscaling.
+    int min_distance = numeric_limits<int>::max();
+    for (const auto &file : index.files(iconName))
+        if (const auto distance = dirs[file.directory].sizeDistance(size);
+            distance < min_distance || (distance == min_distance && pixels(file) > pixels(*best)))
+        {
+            min_distance = distance;
+            best = &file;
+        }
+
+    return best;
 }
 
 XDG::IconLookup::IconLookup()
@@ -41,23 +86,50 @@ XDG::IconLookup::IconLookup()
 
     if (path = QStringLiteral("/usr/share/pixmaps"); QFile::exists(path))
         iconDirs_.append(path);
+
+    // Index the unsorted icons. First dir wins, png before svg before xpm.
+    QHash<QString, qsizetype> ranks;
+    for (const QString &iconDir: iconDirs_)
+    {
+        QHash<QString, qsizetype> dir_ranks;
+        QDir dir(iconDir);
+        for (const QString &fileName : dir.entryList(QDir::Files | QDir::System))
+        {
+            const auto dot = fileName.lastIndexOf(u'.');
+            const auto rank = dot < 1 ? -1 : icon_extensions.indexOf(fileName.mid(dot + 1));
+            if (rank < 0)
+                continue;
+
+            const auto iconName = fileName.left(dot);
+            if (ranks.contains(iconName))
+                continue;  // found in a previous dir
+
+            if (auto it = dir_ranks.find(iconName); it == dir_ranks.end() || rank < it.value())
+            {
+                dir_ranks[iconName] = rank;
+                unsortedIcons_[iconName] = dir.filePath(fileName);
+            }
+        }
+        ranks.insert(dir_ranks);
+    }
 }
 
-XDG::IconLookup *XDG::IconLookup::instance()
+XDG::IconLookup::~IconLookup() = default;
+
+XDG::IconLookup &XDG::IconLookup::instance()
 {
-    static IconLookup *instance_ = nullptr;
-    if (!instance_)
-        instance_ = new IconLookup();
-    return instance_;
+    static IconLookup instance;
+    return instance;
 }
 
-QString XDG::IconLookup::themeIconPath(QString iconName, QString themeName)
+QString XDG::IconLookup::themeIconPath(QString iconName, int size, QString themeName)
 {
     if (iconName.isEmpty())
         return {};
 
+    // QIcon::themeName() must not be read off the GUI thread, callers pass the theme
     if (themeName.isEmpty())
-        themeName = QIcon::themeName();
+        themeName = QStringLiteral("hicolor");
 
     // if we have an absolute path, just return it
     if (iconName[0] == '/') {
@@ -73,33 +145,38 @@ QString XDG::IconLookup::themeIconPath(QString iconName, QString themeName)
             iconName.chop(4);
 
     // Check cache
-    try {
-        return iconCache_.at(iconName);
-    } catch (const out_of_range &) {}
+    const auto key = make_tuple(themeName, iconName, size);
+    {
+        shared_lock lock(iconCacheMutex_);
+        if (auto it = iconCache_.find(key); it != iconCache_.end())
+            return it->second;
+    }
+
+    // Also store misses to avoid repeated expensive lookups
+    auto iconPath = doLookup(iconName, size, themeName);
+    unique_lock lock(iconCacheMutex_);
+    return iconCache_.emplace(key, iconPath).first->second;
+}
 
+QString XDG::IconLookup::doLookup(const QString &iconName, int size, const QString &themeName)
+{
     QStringList checkedThemes;
     QString iconPath;
 
     // Lookup themefile
-    if (!(iconPath = doRecursiveIconLookup(iconName, themeName, &checkedThemes)).isNull())
-        return iconCache_.emplace(iconName, iconPath).first->second;
+    if (!(iconPath = doRecursiveIconLookup(iconName, size, themeName, &checkedThemes)).isNull())
+        return iconPath;
 
     // Lookup in hicolor
     if (!checkedThemes.contains("hicolor"))
-        if (!(iconPath = doRecursiveIconLookup(iconName, "hicolor", &checkedThemes)).isNull())
-            return iconCache_.emplace(iconName, iconPath).first->second;
+        if (!(iconPath = doRecursiveIconLookup(iconName, size, "hicolor", &checkedThemes)).isNull())
+            return iconPath;
 
     // Now search unsorted
-    for (const QString &iconDir: iconDirs_)
-        for (const QString &ext: icon_extensions)
-            if (QFile(iconPath = QString("%1/%2.%3").arg(iconDir, iconName, ext)).exists())
-                return iconCache_.emplace(iconName, iconPath).first->second;
-
-    // Nothing found, save though to avoid repeated expensive lookups
-    return iconCache_.emplace(iconName, QString()).first->second;
+    return unsortedIcons_.value(iconName);
 }
 
-QString XDG::IconLookup::doRecursiveIconLookup(const QString &iconName, const QString &themeName, QStringList *checked)
+QString XDG::IconLookup::doRecursiveIconLookup(const QString &iconName, int size, const QString &themeName, QStringList *checked)
 {
     // Exlude multiple scans
     if (checked->contains(themeName))
@@ -107,19 +184,17 @@ QString XDG::IconLookup::doRecursiveIconLookup(const QString &iconName, const QS
     checked->append(themeName);
 
     // Check if theme exists
-    QString themeFile = lookupThemeFile(themeName);
-    if (themeFile.isNull())
+    const auto *index = themeIndex(themeName);
+    if (!index)
         return {};
 
     // Check if icon exists
-    QString iconPath;
-    iconPath = doIconLookup(iconName, themeFile);
-    if (!iconPath.isNull())
-        return iconPath;
+    if (const auto *file = bestFile(*index, iconName, size); file)
+        return file->path;
 
     // Check its parents too
-    for (const QString &parent: ThemeFileParser(themeFile).inherits()) {
-        iconPath = doRecursiveIconLookup(iconName, parent, checked);
+    for (const QString &parent: index->inherits()) {
+        QString iconPath = doRecursiveIconLookup(iconName, size, parent, checked);
         if (!iconPath.isNull())
             return iconPath;
     }
@@ -127,47 +202,16 @@ QString XDG::IconLookup::doRecursiveIconLookup(const QString &iconName, const QS
     return {};
 }
 
-QString XDG::IconLookup::doIconLookup(const QString &iconName, const QString &themeFile)
+const XDG::ThemeIndex *XDG::IconLookup::themeIndex(const QString &themeName)
 {
-    ThemeFileParser themeFileParser(themeFile);
-    QDir themeDir = QFileInfo(themeFile).dir();
-    QString themeName = themeDir.dirName();
-
-    // Get the sizes of the dirs
-    vector<pair<QString, int>> dirsAndSizes;
-    for (const QString &subdir: themeFileParser.directories())
-        dirsAndSizes.push_back(make_pair(subdir, themeFileParser.size(subdir)));
-
-    // Sort them by size
-    sort(dirsAndSizes.begin(), dirsAndSizes.end(),
-         [](pair<QString, int> a, pair<QString, int> b) {
-             return a.second > b.second;
-         });
-
-    // Well now search for a file beginning with the greatest
-    QString filename;
-    QFile file;
-    for (const auto &dirAndSize: dirsAndSizes) {
-        for (const QString &iconDir: iconDirs_) {
-            for (const QString &ext: icon_extensions) {
-                filename = QString("%1/%2/%3/%4.%5").arg(iconDir, themeName, dirAndSize.first, iconName, ext);
-                if (file.exists(filename)) {
-                    return filename;
-                }
-            }
-        }
-    }
+    // Indices are never removed, the pointers stay valid
+    lock_guard lock(themeIndicesMutex_);
+    if (auto it = themeIndices_.find(themeName); it != themeIndices_.end())
+        return it->second.get();
 
-    return {};
-}
+    const auto cache_file = QString::fromStdString(
+        (albert::cacheLocation() / "icon_theme_index" / themeName.toStdString()).string());
 
-QString XDG::IconLookup::lookupThemeFile(const QString &themeName)
-{
-    // Lookup themefile
-    for (const QString &iconDir: iconDirs_) {
-        QString indexFile = QString("%1/%2/index.theme").arg(iconDir, themeName);
-        if (QFile(indexFile).exists())
-            return indexFile;
-    }
-    return {};
+    return themeIndices_.emplace(themeName, ThemeIndex::load(themeName, iconDirs_, cache_file))
+        .first->second.get();
 }
@@ -3,18 +3,26 @@
 #pragma once
 #include <QSize>
 #include <QStringList>
+#include <QHash>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <tuple>
 
 namespace XDG {
 
+class ThemeIndex;
+
 class IconLookup
 {
 public:
 
     /**
-     * @brief iconPath Does XDG icon lookup for the given icon name
+     * @brief iconPath Does XDG icon lookup for the given icon name. Thread-safe.
      * @param iconName The icon name to lookup
-     * @param themeName The theme to use, use current theme if empty
+     * @param size The size in device pixels the icon will be used at, largest icon if invalid
+     * @param themeName The theme to use, hicolor if empty
      * @return If an icon was found the path to the icon, else an empty string
      */
     static QString iconPath(QString iconName, QSize size = QSize(), QString themeName = QString());
@@ -22,15 +30,23 @@ public:
 private:
 
     IconLookup();
-    static IconLookup *instance();
+    ~IconLookup();
+    static IconLookup &instance();
 
-    QString themeIconPath(QString iconName, QString themeName = QString());
-    QString doRecursiveIconLookup(const QString &iconName, const QString &theme, QStringList *checked);
-    QString doIconLookup(const QString &iconName, const QString &themeFile);
-    QString lookupThemeFile(const QString &themeName);
+    QString themeIconPath(QString iconName, int size, QString themeName);
+    QString doLookup(const QString &iconName, int size, const QString &themeName);
+    QString doRecursiveIconLookup(const QString &iconName, int size, const QString &theme, QStringList *checked);
+    const ThemeIndex *themeIndex(const QString &themeName);
 
+    // Immutable after construction
     QStringList iconDirs_;
-    std::map<QString, QString> iconCache_;
+    QHash<QString, QString> unsortedIcons_;
+
+    std::shared_mutex iconCacheMutex_;
+    std::map<std::tuple<QString, QString, int>, QString> iconCache_;  // (theme, icon, size) -> path
+
+    std::mutex themeIndicesMutex_;
+    std::map<QString, std::unique_ptr<ThemeIndex>> themeIndices_;  // nullptr: theme not found
 };
 
 }
@@ -70,7 +70,7 @@ int XDG::ThemeFileParser::maxSize(const QString &directory)
 {
     iniFile_.beginGroup(directory);
     int result = iniFile_.contains("MaxSize") ? iniFile_.value("MaxSize").toInt()
-                                              : size(directory);
+                                              : iniFile_.value("Size").toInt();
     iniFile_.endGroup();
     return result;
 }
@@ -79,7 +79,7 @@ int XDG::ThemeFileParser::minSize(const QString &directory)
 {
     iniFile_.beginGroup(directory);
     int result = iniFile_.contains("MinSize") ? iniFile_.value("MinSize").toInt()
-                                              : size(directory);
+                                              : iniFile_.value("Size").toInt();
     iniFile_.endGroup();
     return result;
 }
@@ -92,3 +92,11 @@ int XDG::ThemeFileParser::threshold(const QString &directory)
     iniFile_.endGroup();
     return result;
 }
+
+int XDG::ThemeFileParser::scale(const QString &directory)
+{
+    iniFile_.beginGroup(directory);
+    int result = iniFile_.contains("Scale") ? iniFile_.value("Scale").toInt() : 1;
+    iniFile_.endGroup();
+    return result;
+}
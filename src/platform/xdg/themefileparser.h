@@ -24,6 +24,7 @@ public:
     int maxSize(const QString& directory);
     int minSize(const QString& directory);
     int threshold(const QString& directory);
+    int scale(const QString& directory);
 
 private:
 
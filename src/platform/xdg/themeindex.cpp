@@ -0,0 +1,279 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#include "logging.h"
+#include "themefileparser.h"
+#include "themeindex.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstdlib>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+static const quint32 cache_magic = 0x414c5849;  // ALXI
+static const quint32 cache_version = 2;
+
+static qint64 modificationTime(const QString &path)
+{
+    QFileInfo fi(path);
+    return fi.exists() ? fi.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+// https://specifications.freedesktop.org/icon-theme-spec/latest/#icon_lookup
+// Sizes are compared in device pixels, i.e. scaled by the directory scale.
+
+bool XDG::ThemeIndex::Directory::matchesSize(int s) const
+{
+    if (type == u"Fixed"_s)
+        return s == size * scale;
+    else if (type == u"Scalable"_s)
+        return min_size * scale <= s && s <= max_size * scale;
+    else  // Threshold
+        return (size - threshold) * scale <= s && s <= (size + threshold) * scale;
+}
+
+int XDG::ThemeIndex::Directory::sizeDistance(int s) const
+{
+    if (type == u"Fixed"_s)
+        return abs(size * scale - s);
+    else if (type == u"Scalable"_s)
+    {
+        if (s < min_size * scale)
+            return min_size * scale - s;
+        if (s > max_size * scale)
+            return s - max_size * scale;
+        return 0;
+    }
+    else  // Threshold
+    {
+        if (s < (size - threshold) * scale)
+            return (size - threshold) * scale - s;
+        if (s > (size + threshold) * scale)
+            return s - (size + threshold) * scale;
+        return 0;
+    }
+}
+
+const QStringList &XDG::ThemeIndex::extensions()
+{
+    static const QStringList extensions{u"png"_s, u"svg"_s, u"xpm"_s};
+    return extensions;
+}
+
+unique_ptr<XDG::ThemeIndex> XDG::ThemeIndex::load(const QString &themeName,
+                                                  const QStringList &baseDirs,
+                                                  const QString &cacheFile)
+{
+    unique_ptr<ThemeIndex> index(new ThemeIndex);
+
+    if (index->read(cacheFile, themeName, baseDirs))
+    {
+        DEBG << "Loaded icon theme index from cache:" << themeName << index->size() << "icons";
+        return index;
+    }
+
+    index.reset(new ThemeIndex);
+    QElapsedTimer t;
+    t.start();
+
+    if (!index->build(themeName, baseDirs))
+        return {};
+
+    DEBG << QString("Built icon theme index of '%1' in %2 ms. %3 icons.")
+                .arg(themeName).arg(t.elapsed()).arg(index->size());
+
+    index->write(cacheFile);
+    return index;
+}
+
+const QString &XDG::ThemeIndex::name() const { return name_; }
+
+const QString &XDG::ThemeIndex::themeFile() const { return theme_file_; }
+
+const QStringList &XDG::ThemeIndex::inherits() const { return inherits_; }
+
+const vector<XDG::ThemeIndex::Directory> &XDG::ThemeIndex::directories() const { return directories_; }
+
+const vector<XDG::ThemeIndex::File> &XDG::ThemeIndex::files(const QString &iconName) const
+{
+    static const vector<File> none;
+    if (auto it = icons_.constFind(iconName); it != icons_.constEnd())
+        return it.value();
+    return none;
+}
+
+qsizetype XDG::ThemeIndex::size() const { return icons_.size(); }
+
+bool XDG::ThemeIndex::build(const QString &themeName, const QStringList &baseDirs)
+{
+    name_ = themeName;
+    base_dirs_ = baseDirs;
+
+    // The theme file of the first base dir containing the theme is authoritative.
+    // Track the theme dirs in all base dirs to notice themes appearing.
+    for (const auto &base_dir : baseDirs)
+    {
+        const auto theme_dir = QDir(base_dir).filePath(themeName);
+        mtimes_.emplace_back(theme_dir, modificationTime(theme_dir));
+        if (const auto theme_file = QDir(theme_dir).filePath(u"index.theme"_s);
+            theme_file_.isNull() && QFile::exists(theme_file))
+            theme_file_ = theme_file;
+    }
+
+    if (theme_file_.isNull())
+        return false;
+
+    mtimes_.emplace_back(theme_file_, modificationTime(theme_file_));
+
+    ThemeFileParser parser(theme_file_);
+    inherits_ = parser.inherits();
+    for (const auto &dir : parser.directories())
+        directories_.emplace_back(dir,
+                                  parser.type(dir),
+                                  parser.size(dir),
+                                  parser.minSize(dir),
+                                  parser.maxSize(dir),
+                                  parser.threshold(dir),
+                                  qMax(1, parser.scale(dir)));
+
+    // One listing per directory instead of a stat per lookup, directory, base dir and extension
+    for (qsizetype i = 0; i < (qsizetype)directories_.size(); ++i)
+    {
+        // name -> (base dir index, extension rank, path)
+        QHash<QString, tuple<qsizetype, qsizetype, QString>> best;
+
+        for (qsizetype b = 0; b < baseDirs.size(); ++b)
+        {
+            const auto path = QStringLiteral("%1/%2/%3").arg(baseDirs[b], themeName, directories_[i].path);
+            mtimes_.emplace_back(path, modificationTime(path));
+
+            QDir dir(path);
+            for (const auto &file_name : dir.entryList(QDir::Files | QDir::System))  // System: broken links
+            {
+                const auto dot = file_name.lastIndexOf(u'.');
+                if (dot < 1)
+                    continue;
+
+                const auto rank = extensions().indexOf(file_name.mid(dot + 1));
+                if (rank < 0)
+                    continue;
+
+                const auto icon_name = file_name.left(dot);
+                if (auto it = best.find(icon_name); it == best.end())
+                    best.emplace(icon_name, b, rank, dir.filePath(file_name));
+                else if (get<0>(*it) == b && rank < get<1>(*it))
+                    *it = {b, rank, dir.filePath(file_name)};
+            }
+        }
+
+        for (auto it = best.begin(); it != best.end(); ++it)
+            icons_[it.key()].emplace_back(i, get<2>(it.value()));
+    }
+
+    return true;
+}
+
+bool XDG::ThemeIndex::read(const QString &cacheFile, const QString &themeName, const QStringList &baseDirs)
+{
+    QFile file(cacheFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != cache_magic || version != cache_version)
+        return false;
+
+    in >> name_ >> base_dirs_;
+    if (name_ != themeName || base_dirs_ != baseDirs)
+        return false;
+
+    qsizetype count;
+    in >> count;
+    for (qsizetype i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        QString path;
+        qint64 mtime;
+        in >> path >> mtime;
+        if (modificationTime(path) != mtime)
+        {
+            DEBG << "Icon theme index outdated:" << path;
+            return false;
+        }
+        mtimes_.emplace_back(path, mtime);
+    }
+
+    in >> theme_file_ >> inherits_ >> count;
+    for (qsizetype i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        Directory d;
+        in >> d.path >> d.type >> d.size >> d.min_size >> d.max_size >> d.threshold >> d.scale;
+        directories_.emplace_back(::move(d));
+    }
+
+    in >> count;
+    icons_.reserve(count);
+    for (qsizetype i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        QString icon_name;
+        qsizetype file_count;
+        in >> icon_name >> file_count;
+        auto &files = icons_[icon_name];
+        for (qsizetype f = 0; f < file_count && in.status() == QDataStream::Ok; ++f)
+        {
+            File file;
+            in >> file.directory >> file.path;
+            files.emplace_back(::move(file));
+        }
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        WARN << "Failed reading icon theme index:" << cacheFile;
+        return false;
+    }
+
+    return true;
+}
+
+void XDG::ThemeIndex::write(const QString &cacheFile) const
+{
+    QDir().mkpath(QFileInfo(cacheFile).path());
+
+    QSaveFile file(cacheFile);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        WARN << "Failed to open icon theme index for writing:" << cacheFile << file.errorString();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << cache_magic << cache_version << name_ << base_dirs_;
+
+    out << (qsizetype)mtimes_.size();
+    for (const auto &[path, mtime] : mtimes_)
+        out << path << mtime;
+
+    out << theme_file_ << inherits_ << (qsizetype)directories_.size();
+    for (const auto &d : directories_)
+        out << d.path << d.type << d.size << d.min_size << d.max_size << d.threshold << d.scale;
+
+    out << icons_.size();
+    for (auto it = icons_.cbegin(); it != icons_.cend(); ++it)
+    {
+        out << it.key() << (qsizetype)it.value().size();
+        for (const auto &f : it.value())
+            out << f.directory << f.path;
+    }
+
+    if (!file.commit())
+        WARN << "Failed to write icon theme index:" << cacheFile << file.errorString();
+}
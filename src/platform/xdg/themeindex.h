@@ -0,0 +1,95 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#pragma once
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace XDG {
+
+///
+/// In-memory index of the icons of an icon theme.
+///
+/// Maps icon names to the files available in the theme directories, such that lookups do not
+/// touch the file system. The index is built by listing each theme directory once and persisted
+/// to a cache file, which is validated by the modification times of the theme directories (like
+/// `icon-theme.cache` of GTK).
+///
+class ThemeIndex
+{
+public:
+
+    /// A theme directory as described in the theme file.
+    struct Directory
+    {
+        QString path;  ///< Relative to the theme directory.
+        QString type;  ///< Fixed, Scalable or Threshold.
+        int size;
+        int min_size;
+        int max_size;
+        int threshold;
+        int scale;
+
+        /// Returns true if the icons in this directory match `size` (in device pixels).
+        bool matchesSize(int size) const;
+
+        /// Returns the distance of `size` (in device pixels) to the sizes of this directory.
+        int sizeDistance(int size) const;
+    };
+
+    /// An icon file.
+    struct File
+    {
+        qsizetype directory;  ///< Index into directories().
+        QString path;
+    };
+
+    ///
+    /// Returns the index of the theme `themeName` found in `baseDirs`.
+    ///
+    /// Reads the index from `cacheFile` if it is still valid, otherwise builds the index and
+    /// writes it to `cacheFile`.
+    ///
+    /// \returns The index or nullptr if the theme does not exist.
+    ///
+    static std::unique_ptr<ThemeIndex> load(const QString &themeName,
+                                            const QStringList &baseDirs,
+                                            const QString &cacheFile);
+
+    /// The supported icon file extensions in order of preference.
+    static const QStringList &extensions();
+
+    const QString &name() const;
+    const QString &themeFile() const;
+    const QStringList &inherits() const;
+    const std::vector<Directory> &directories() const;
+
+    /// The files of `iconName`, at most one per directory, in theme file order. If a
+    /// directory contains multiple files, png is preferred over svg over xpm.
+    const std::vector<File> &files(const QString &iconName) const;
+
+    /// The number of icon names in the index.
+    qsizetype size() const;
+
+private:
+
+    ThemeIndex() = default;
+
+    bool build(const QString &themeName, const QStringList &baseDirs);
+    bool read(const QString &cacheFile, const QString &themeName, const QStringList &baseDirs);
+    void write(const QString &cacheFile) const;
+
+    QString name_;
+    QString theme_file_;
+    QStringList base_dirs_;
+    QStringList inherits_;
+    std::vector<Directory> directories_;
+    QHash<QString, std::vector<File>> icons_;
+    std::vector<std::pair<QString, qint64>> mtimes_;  // paths validating the index
+
+};
+
+}
@@ -9,11 +9,15 @@
 #include "pluginloader.h"
 #include "pluginmetadata.h"
 #include "pluginregistry.h"
+#include "settingsstore.h"
 #include <QApplication>
+#include <QEventLoop>
+#include <QFutureWatcher>
 #include <QMessageBox>
 #include <QRegularExpression>
-#include <QSettings>
+#include <QtConcurrentRun>
 #include <chrono>
+using namespace albert::util;
 using namespace albert;
 using namespace std::chrono;
 using namespace std;
@@ -22,9 +26,11 @@ Plugin::Plugin(PluginProvider *provider_, PluginLoader *loader_):
     provider(provider_),
     loader(loader_),
     state_(State::Unloaded),
+    load_duration_(0),
+    instantiate_duration_(0),
     instance_(nullptr)
 {
-    enabled_ = settings()->value(QString("%1/enabled").arg(id()), false).toBool();
+    enabled_ = SettingsStore::config().value(QString("%1/enabled").arg(id()), false).toBool();
 
     const auto &md = loader->metaData();
 
@@ -63,7 +69,7 @@ void Plugin::setEnabled(bool enable)
 {
     if (isUser() && enabled_ != enable)
     {
-        settings()->setValue(QString("%1/enabled").arg(id()), enabled_ = enable);
+        SettingsStore::config().setValue(QString("%1/enabled").arg(id()), enabled_ = enable);
         emit enabledChanged();
     }
 }
@@ -109,25 +115,54 @@ QString Plugin::load() noexcept
 
     setState(State::Busy, tr("Loading…"));
 
-    QStringList errors;
+    QFutureWatcher<void> watcher;
+    QEventLoop loop;
+    QObject::connect(&watcher, &QFutureWatcher<void>::finished, &loop, &QEventLoop::quit);
+    watcher.setFuture(QtConcurrent::run([this]{ loadLibrary(); }));
+    loop.exec();
+
+    return instantiate();
+}
+
+void Plugin::loadLibrary() noexcept
+{
+    load_error_.clear();
+    load_duration_ = {};
+    instantiate_duration_ = {};
 
     try
     {
         auto tp = system_clock::now();
         loader->load();
-        auto dur_l = duration_cast<milliseconds>(system_clock::now() - tp).count();
-        DEBG << QStringLiteral("%1 ms spent loading plugin '%2'").arg(dur_l).arg(id());
+        load_duration_ = duration_cast<milliseconds>(system_clock::now() - tp);
+        DEBG << QStringLiteral("%1 ms spent loading plugin '%2'").arg(load_duration_.count()).arg(id());
+        return;
+    }
+    catch (const exception& e) { load_error_ = e.what(); }
+    catch (...){ load_error_ = tr("Unknown exception occurred."); }
+}
+
+QString Plugin::instantiate() noexcept
+{
+    QStringList errors;
+
+    try
+    {
+        if (!load_error_.isEmpty())
+            throw runtime_error(load_error_.toStdString());
 
-        tp = system_clock::now();
+        auto tp = system_clock::now();
         PluginRegistry::staticDI.loader = loader;
         instance_ = loader->createInstance();
-        auto dur_c = duration_cast<milliseconds>(system_clock::now() - tp).count();
-        DEBG << QStringLiteral("%1 ms spent instanciating plugin '%2'").arg(dur_c).arg(id());
+        instantiate_duration_ = duration_cast<milliseconds>(system_clock::now() - tp);
+        DEBG << QStringLiteral("%1 ms spent instanciating plugin '%2'")
+                    .arg(instantiate_duration_.count()).arg(id());
 
         if (!instance_)
             throw runtime_error("createInstance() returned nullptr");
 
-        setState(State::Loaded, tr("Load: %1 ms, Instanciate: %2 ms").arg(dur_l).arg(dur_c));
+        setState(State::Loaded, tr("Load: %1 ms, Instanciate: %2 ms")
+                                    .arg(load_duration_.count()).arg(instantiate_duration_.count()));
         return {};
     }
     catch (const exception& e) { errors << e.what(); }
@@ -172,18 +207,36 @@ const QString &Plugin::id() const { return loader->metaData().id; }
 
 const PluginMetaData &Plugin::metaData() const { return loader->metaData(); }
 
-set<Plugin*> Plugin::transitiveDependencies() const
+// The closures of the dependencies are memoized as well, i.e. each closure is computed once.
+
+const set<Plugin*> &Plugin::transitiveDependencies() const
 {
-    set<Plugin*> dependencies = dependencies_;
-    for (const auto &dependency : dependencies_)
-        dependencies.merge(dependency->transitiveDependencies());
-    return dependencies;
+    if (!transitive_dependencies_)
+    {
+        set<Plugin*> dependencies = dependencies_;
+        for (const auto &dependency : dependencies_)
+            for (auto *d : dependency->transitiveDependencies())
+                dependencies.insert(d);
+        transitive_dependencies_ = ::move(dependencies);
+    }
+    return *transitive_dependencies_;
+}
+
+const set<Plugin*> &Plugin::transitiveDependees() const
+{
+    if (!transitive_dependees_)
+    {
+        set<Plugin*> dependees = dependees_;
+        for (const auto &dependee : dependees_)
+            for (auto *d : dependee->transitiveDependees())
+                dependees.insert(d);
+        transitive_dependees_ = ::move(dependees);
+    }
+    return *transitive_dependees_;
 }
 
-set<Plugin*> Plugin::transitiveDependees() const
+void Plugin::invalidateTransitiveClosures()
 {
-    set<Plugin*> dependees = dependees_;
-    for (const auto &dependee : dependees_)
-        dependees.merge(dependee->transitiveDependees());
-    return dependees;
+    transitive_dependencies_.reset();
+    transitive_dependees_.reset();
 }
@@ -3,6 +3,8 @@
 #pragma once
 #include <QObject>
 #include <QString>
+#include <chrono>
+#include <optional>
 #include <set>
 namespace albert {
 class ExtensionRegistry;
@@ -48,18 +50,32 @@ private:
     QString load() noexcept;
     QString unload() noexcept;
 
-    std::set<Plugin*> transitiveDependencies() const;
-    std::set<Plugin*> transitiveDependees() const;
+    // Two stage loading, used by load() and the parallel loading of PluginRegistry.
+    // Expects the state to be set to Busy by the caller. Safe to be called in a background
+    // thread concurrently with other plugins. Neither sets the state nor emits signals.
+    void loadLibrary() noexcept;
+    // Instantiates the plugin loaded by loadLibrary() in the main thread and sets the state.
+    QString instantiate() noexcept;
+
+    // Memoized. Invalidated by PluginRegistry when the dependency graph changes.
+    const std::set<Plugin*> &transitiveDependencies() const;
+    const std::set<Plugin*> &transitiveDependees() const;
+    void invalidateTransitiveClosures();
 
     void setState(State, QString info = {});
 
     albert::PluginLoader * const loader;
     std::set<Plugin*> dependencies_;
     std::set<Plugin*> dependees_;
+    mutable std::optional<std::set<Plugin*>> transitive_dependencies_;
+    mutable std::optional<std::set<Plugin*>> transitive_dependees_;
     uint load_order;
     bool enabled_;
     QString state_info_;
     State state_;
+    QString load_error_;
+    std::chrono::milliseconds load_duration_;
+    std::chrono::milliseconds instantiate_duration_;
     albert::PluginInstance *instance_;
 
     friend class PluginRegistry;
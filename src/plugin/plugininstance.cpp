@@ -60,6 +60,12 @@ unique_ptr<QSettings> PluginInstance::state() const
     return s;
 }
 
+util::SettingsGroup PluginInstance::cachedSettings() const
+{ return {util::SettingsStore::config(), d->loader->metaData().id}; }
+
+util::SettingsGroup PluginInstance::cachedState() const
+{ return {util::SettingsStore::state(), d->loader->metaData().id}; }
+
 const PluginLoader &PluginInstance::loader() const
 { return *d->loader; }
 
@@ -1,17 +1,33 @@
 // Copyright (c) 2023-2024 Manuel Schneider
 
+#include "albert.h"
 #include "extensionregistry.h"
+#include "fallbackhandler.h"
+#include "globalqueryhandler.h"
 #include "logging.h"
 #include "plugininstance.h"
 #include "pluginloader.h"
 #include "pluginmetadata.h"
 #include "pluginprovider.h"
 #include "pluginregistry.h"
+#include "settingsstore.h"
 #include "topologicalsort.hpp"
+#include "triggerqueryhandlerproxy.h"
 #include <QApplication>
+#include <QEventLoop>
+#include <QFutureWatcher>
 #include <QMessageBox>
+#include <QtConcurrentMap>
+#include <chrono>
+using namespace albert::util;
 using namespace albert;
+using namespace std::chrono;
 using namespace std;
+static const char *CFG_LAZY_ACTIVATION = "lazy_plugin_activation";
+static const char *STATE_LAZY_ACTIVATION = "lazy_activation";
+static const char *KEY_VERSION = "version";
+static const char *KEY_PATH = "path";
+static const char *KEY_HANDLERS = "handlers";
 
 PluginRegistry::StaticDI PluginRegistry::staticDI
 {
@@ -138,25 +154,16 @@ void PluginRegistry::load(const QString &id)
         auto s = plugin.transitiveDependencies();
         s.insert(&plugin);
 
-        vector<Plugin*> v{s.cbegin(), s.cend()};
-        ::sort(v.begin(), v.end(), [](auto *l, auto *r){ return l->load_order < r->load_order; });
-
-        QStringList errors;
-        for (auto *p : v)
+        vector<Plugin*> v;
+        for (auto *p : s)
             if (p->state() != Plugin::State::Loaded)
             {
-                if (auto err = p->load(); err.isEmpty())
-                {
-                    for (auto *e : p->instance()->extensions())
-                        extension_registry_.registerExtension(e);
-                }
-                else
-                {
-                    WARN << QString("Failed loading plugin '%1': %2").arg(p->id(), err);
-                    errors << p->metaData().name;
-                }
+                deregisterLazyActivationProxies(p);
+                v.push_back(p);
             }
 
+        auto errors = loadPlugins(::move(v));
+
         if (!errors.isEmpty())
             QMessageBox::warning(nullptr, qApp->applicationDisplayName(),
                                  QString("%1:\n\n%2\n\n%3")
@@ -183,6 +190,8 @@ void PluginRegistry::unload(const QString &id)
         QStringList errors;
         for (auto *p : v)
         {
+            deregisterLazyActivationProxies(p);
+
             if (p->state() == Plugin::State::Loaded)
                 for (auto *e : p->instance()->extensions())
                     extension_registry_.deregisterExtension(e);
@@ -206,6 +215,176 @@ void PluginRegistry::unload(const QString &id)
     }
 }
 
+QStringList PluginRegistry::loadPlugins(vector<Plugin*> plugins)
+{
+    // Dependencies outside of the set are expected to be loaded already
+    map<Plugin*, set<Plugin*>> graph;
+    for (auto *p : plugins)
+        graph[p];
+    for (auto *p : plugins)
+        for (auto *d : p->dependencies_)
+            if (graph.contains(d))
+                graph[p].insert(d);
+
+    auto waves = topologicalWaves(graph).waves;  // plugins are a DAG by construction
+
+    const bool lazy_activation = SettingsStore::config().value(CFG_LAZY_ACTIVATION, false).toBool();
+    QStringList errors;
+    map<Plugin*, milliseconds> critical_paths;  // longest chain of load and instantiation times
+    milliseconds sequential{0};
+    const auto tp = system_clock::now();
+
+    for (auto &wave : waves)
+    {
+        // Instantiate in load order for deterministic behavior
+        ::sort(wave.begin(), wave.end(),
+               [](const auto *l, const auto *r){ return l->load_order < r->load_order; });
+
+        vector<Plugin*> jobs;
+        for (auto *p : wave)
+            if (p->state() == Plugin::State::Unloaded)
+            {
+                p->setState(Plugin::State::Busy, Plugin::tr("Loading…"));
+                jobs.push_back(p);
+            }
+            else
+            {
+                WARN << QString("Failed loading plugin '%1': %2").arg(p->id(), p->localStateString());
+                errors << p->metaData().name;
+            }
+
+        if (jobs.empty())
+            continue;
+
+        // Load libraries concurrently, keep the event loop spinning meanwhile
+        QFutureWatcher<void> watcher;
+        QEventLoop loop;
+        connect(&watcher, &QFutureWatcher<void>::finished, &loop, &QEventLoop::quit);
+        watcher.setFuture(QtConcurrent::map(jobs, [](Plugin *p){ p->loadLibrary(); }));
+        loop.exec();
+
+        // Instantiate in the main thread
+        for (auto *p : jobs)
+        {
+            if (auto err = p->instantiate(); err.isEmpty())
+            {
+                for (auto *e : p->instance()->extensions())
+                    extension_registry_.registerExtension(e);
+
+                if (lazy_activation && p->metaData().lazy_activation)
+                    recordLazyActivationMetaData(p);
+            }
+            else
+            {
+                WARN << QString("Failed loading plugin '%1': %2").arg(p->id(), err);
+                errors << p->metaData().name;
+            }
+
+            const auto duration = p->load_duration_ + p->instantiate_duration_;
+            sequential += duration;
+
+            milliseconds longest_dependency{0};
+            for (auto *d : graph.at(p))
+                longest_dependency = max(longest_dependency, critical_paths[d]);
+            critical_paths[p] = longest_dependency + duration;
+        }
+    }
+
+    if (!plugins.empty())
+    {
+        const auto wall = duration_cast<milliseconds>(system_clock::now() - tp);
+        milliseconds critical_path{0};
+        for (const auto &[p, d] : critical_paths)
+            critical_path = max(critical_path, d);
+
+        INFO << QString("Loaded %1 plugins in %2 waves in %3 ms (sequential sum: %4 ms, critical path: %5 ms)")
+                    .arg(plugins.size()).arg(waves.size()).arg(wall.count())
+                    .arg(sequential.count()).arg(critical_path.count());
+    }
+
+    return errors;
+}
+
+void PluginRegistry::recordLazyActivationMetaData(Plugin *plugin)
+{
+    // Eligible are opted in plugins providing trigger query handlers only, which no plugin
+    // depends on
+    QVariantList handlers;
+    bool eligible = plugin->dependees_.empty();
+    for (auto *e : plugin->instance()->extensions())
+    {
+        auto *th = dynamic_cast<albert::TriggerQueryHandler*>(e);
+        if (!th || dynamic_cast<GlobalQueryHandler*>(e) || dynamic_cast<FallbackHandler*>(e))
+        {
+            eligible = false;
+            break;
+        }
+        handlers << TriggerQueryHandlerProxy::record(th);
+    }
+
+    SettingsGroup s(SettingsStore::state(), STATE_LAZY_ACTIVATION);
+    if (eligible && !handlers.isEmpty())
+        s.setValue(plugin->id(), QVariantMap{{KEY_VERSION, plugin->metaData().version},
+                                             {KEY_PATH, plugin->path()},
+                                             {KEY_HANDLERS, handlers}});
+    else
+        s.remove(plugin->id());
+}
+
+bool PluginRegistry::registerLazyActivationProxies(Plugin *plugin)
+{
+    if (!plugin->metaData().lazy_activation)
+        return false;
+
+    const auto record = SettingsStore::state().value(QString("%1/%2").arg(STATE_LAZY_ACTIVATION, plugin->id())).toMap();
+    if (record.isEmpty()
+        || record[KEY_VERSION].toString() != plugin->metaData().version
+        || record[KEY_PATH].toString() != plugin->path())
+        return false;
+
+    for (const auto *dependee : plugin->dependees_)
+        if (dependee->isEnabled())
+            return false;
+
+    // Activate in the main thread, queued since the proxy is called in a query thread
+    auto activate = [this, id=plugin->id()]{
+        QMetaObject::invokeMethod(this, [this, id]{
+            INFO << QString("Activating plugin '%1' on first use.").arg(id);
+            load(id);
+            emit activatedOnFirstUse(id);
+        }, Qt::QueuedConnection);
+    };
+
+    auto &entry = lazy_activation_proxies_[plugin];
+    entry.proxies.clear();
+    for (const auto &handler_record : record[KEY_HANDLERS].toList())
+        entry.proxies.emplace_back(make_unique<TriggerQueryHandlerProxy>(handler_record.toMap(), activate));
+    for (auto &proxy : entry.proxies)
+        extension_registry_.registerExtension(proxy.get());
+    entry.registered = true;
+
+    plugin->setState(Plugin::State::Unloaded, tr("Deferred until first use."));
+    DEBG << QString("Deferred loading plugin '%1' until first use.").arg(plugin->id());
+    return true;
+}
+
+void PluginRegistry::deregisterLazyActivationProxies(Plugin *plugin)
+{
+    if (auto it = lazy_activation_proxies_.find(plugin);
+        it != lazy_activation_proxies_.end() && it->second.registered)
+    {
+        for (auto &proxy : it->second.proxies)
+            extension_registry_.deregisterExtension(proxy.get());
+        it->second.registered = false;
+    }
+}
+
+void PluginRegistry::invalidateTransitiveClosures()
+{
+    for (auto &[id, plugin] : registered_plugins_)
+        plugin.invalidateTransitiveClosures();
+}
+
 void PluginRegistry::onRegistered(Extension *extension)
 {
     auto *plugin_provider = dynamic_cast<PluginProvider*>(extension);
@@ -278,34 +457,24 @@ void PluginRegistry::onRegistered(Extension *extension)
                 this, [this, &plugin] { emit stateChanged(plugin.id()); });
     }
 
+    invalidateTransitiveClosures();
+
     emit pluginsChanged();
 
     if (!load_enabled_)
         return;
 
     // Load enabled user plugins of this provider
+    // In lazy activation mode defer plugins having recorded proxy metadata
+    const bool lazy_activation = SettingsStore::config().value(CFG_LAZY_ACTIVATION, false).toBool();
     vector<Plugin*> plugins_to_load;
     for (auto &[id, plugin] : registered_plugins_)
         if (plugin.provider == plugin_provider && plugin.isUser() && plugin.isEnabled())
-            plugins_to_load.push_back(&plugin);
-
-    // Sort by load order
-    ::sort(plugins_to_load.begin(), plugins_to_load.end(),
-           [](const auto *l, const auto *r){ return l->load_order < r->load_order; });
+            if (!lazy_activation || !registerLazyActivationProxies(&plugin))
+                plugins_to_load.push_back(&plugin);
 
     // Load enabled plugins
-    QStringList errors;
-    for (auto *p : plugins_to_load)
-        if (auto err = p->load(); err.isEmpty())
-        {
-            for (auto *e : p->instance()->extensions())
-                extension_registry_.registerExtension(e);
-        }
-        else
-        {
-            WARN << QString("Failed loading plugin '%1': %2").arg(p->id(), err);
-            errors << p->metaData().name;
-        }
+    auto errors = loadPlugins(::move(plugins_to_load));
 
     if (!errors.isEmpty())
         QMessageBox::warning(nullptr, qApp->applicationDisplayName(),
@@ -353,9 +522,31 @@ void PluginRegistry::onDeregistered(Extension *extension)
                                       errors.join("\n"),
                                       tr("Check the log for more information.")));
 
-    // Remove registerd plugins of this provider
+    // Remove lazy activation proxies and registerd plugins of this provider
+    for (auto it = lazy_activation_proxies_.begin(); it != lazy_activation_proxies_.end();)
+        if (it->first->provider == plugin_provider)
+        {
+            deregisterLazyActivationProxies(it->first);
+            it = lazy_activation_proxies_.erase(it);
+        }
+        else
+            ++it;
+
+    set<Plugin*> removed;
+    for (auto &[id, plugin] : registered_plugins_)
+        if (plugin.provider == plugin_provider)
+            removed.insert(&plugin);
+
     erase_if(registered_plugins_, [=](const auto& it){ return it.second.provider == plugin_provider; });
 
+    // Drop dangling edges of the remaining plugins
+    for (auto &[id, plugin] : registered_plugins_)
+    {
+        erase_if(plugin.dependencies_, [&](auto *p){ return removed.contains(p); });
+        erase_if(plugin.dependees_, [&](auto *p){ return removed.contains(p); });
+    }
+    invalidateTransitiveClosures();
+
     // Remove provider
     plugin_providers_.erase(plugin_provider);
 
@@ -5,7 +5,10 @@
 #include <QObject>
 #include <QString>
 #include <map>
+#include <memory>
 #include <set>
+#include <vector>
+class TriggerQueryHandlerProxy;
 namespace albert {
 class Extension;
 class ExtensionRegistry;
@@ -48,6 +51,21 @@ public:
 
 
 private:
+    /// Loads the plugins in dependency waves. The libraries of a wave are loaded concurrently,
+    /// then instantiated in the main thread. Registers the extensions of loaded plugins.
+    /// Returns the names of the plugins that failed to load.
+    QStringList loadPlugins(std::vector<Plugin*> plugins);
+
+    // Lazy activation. Opted in plugins whose extensions are trigger query handlers only are
+    // represented by proxies built from metadata recorded on the previous load, until the
+    // trigger is used.
+    void recordLazyActivationMetaData(Plugin *plugin);
+    bool registerLazyActivationProxies(Plugin *plugin);
+    void deregisterLazyActivationProxies(Plugin *plugin);
+
+    // Resets the memoized transitive dependencies and dependees of all plugins.
+    void invalidateTransitiveClosures();
+
     void onRegistered(albert::Extension *extension);
     void onDeregistered(albert::Extension *extension);
 
@@ -56,10 +74,20 @@ private:
     std::map<QString, Plugin> registered_plugins_;
     bool load_enabled_;
 
+    struct LazyActivationProxies
+    {
+        std::vector<std::unique_ptr<TriggerQueryHandlerProxy>> proxies;  // alive until provider removal
+        bool registered;
+    };
+    std::map<Plugin*, LazyActivationProxies> lazy_activation_proxies_;
+
 signals:
 
     void pluginsChanged();
     void enabledChanged(const QString &plugin_id);
     void stateChanged(const QString &plugin_id);
 
+    /// Emitted when a lazily activated plugin replaced its proxies on the first use.
+    void activatedOnFirstUse(const QString &plugin_id);
+
 };
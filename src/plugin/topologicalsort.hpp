@@ -1,6 +1,7 @@
 // Copyright (c) 2024 Manuel Schneider
 
 #pragma once
+#include <algorithm>
 #include <map>
 #include <set>
 #include <vector>
@@ -13,11 +14,82 @@ struct TopologicalSortResult
 };
 
 template<class T>
-TopologicalSortResult<T> topologicalSort(std::map<T, std::set<T>> graph)
+struct TopologicalWavesResult
+{
+    std::vector<std::vector<T>> waves;
+    std::map<T, std::set<T>> error_set;
+};
+
+namespace detail
+{
+
+/// Graph representation used by Kahn's algorithm. Nodes are identified by their index in the
+/// (ordered) keys of the input graph. Edges to nodes that are not in the graph are counted in
+/// the in-degree but never resolved.
+template<class T>
+struct IndexedGraph
+{
+    std::vector<T> nodes;                      // sorted
+    std::vector<size_t> in_degree;             // number of unresolved dependencies
+    std::vector<std::vector<size_t>> dependees;  // adjacency, ascending
+
+    explicit IndexedGraph(const std::map<T, std::set<T>> &graph)
+    {
+        nodes.reserve(graph.size());
+        in_degree.reserve(graph.size());
+        for (const auto &[node, edges] : graph)
+        {
+            nodes.push_back(node);
+            in_degree.push_back(edges.size());
+        }
+
+        dependees.resize(nodes.size());
+        size_t i = 0;
+        for (const auto &[node, edges] : graph)
+        {
+            for (const auto &edge : edges)
+                if (auto it = std::lower_bound(nodes.begin(), nodes.end(), edge);
+                    it != nodes.end() && *it == edge)
+                    dependees[it - nodes.begin()].push_back(i);
+            ++i;
+        }
+    }
+
+    /// The nodes that have not been resolved and their unresolved edges.
+    std::map<T, std::set<T>> errorSet(const std::map<T, std::set<T>> &graph,
+                                      const std::vector<bool> &resolved) const
+    {
+        std::map<T, std::set<T>> error_set;
+        size_t i = 0;
+        for (const auto &[node, edges] : graph)
+        {
+            if (!resolved[i])
+            {
+                auto &unresolved = error_set[node];
+                for (const auto &edge : edges)
+                    if (auto it = std::lower_bound(nodes.begin(), nodes.end(), edge);
+                        it == nodes.end() || *it != edge || !resolved[it - nodes.begin()])
+                        unresolved.insert(edge);
+            }
+            ++i;
+        }
+        return error_set;
+    }
+};
+
+}
+
+///
+/// Sorts the nodes of `graph` topologically using Kahn's algorithm in O(V+E) (plus the edge
+/// lookups of the index construction).
+///
+/// `graph` maps nodes to the nodes they depend on. Dependencies precede their dependees in the
+/// result. Nodes which are part of or depend on cycles or missing nodes are returned in the error
+/// set, mapped to their unresolved dependencies.
+///
+template<class T>
+TopologicalSortResult<T> topologicalSort(const std::map<T, std::set<T>> &graph)
 {
-    // First, find a list of "start nodes" that have no incoming edges
-    // and insert them into a set S; at least one such node must exist
-    // in a non-empty (finite) acyclic graph. Then:
     // L ← Empty list that will contain the sorted elements
     // S ← Set of all nodes with no incoming edge
     // while S is not empty do
@@ -32,37 +104,65 @@ TopologicalSortResult<T> topologicalSort(std::map<T, std::set<T>> graph)
     // else
     //     return L   (a topologically sorted order)
 
-    std::vector<T> degree_0_set;
-    for (auto it = begin(graph); it!= end(graph);)
-    {
-        if (it->second.empty())
-        {
-            degree_0_set.push_back(it->first);
-            it = graph.erase(it);
-        }
-        else
-            ++it;
-    }
+    detail::IndexedGraph<T> g(graph);
+
+    std::vector<size_t> degree_0_set;  // LIFO
+    for (size_t i = 0; i < g.nodes.size(); ++i)
+        if (g.in_degree[i] == 0)
+            degree_0_set.push_back(i);
 
     std::vector<T> ordered;
+    ordered.reserve(g.nodes.size());
+    std::vector<bool> resolved(g.nodes.size(), false);
     while (!degree_0_set.empty())
     {
-        const auto degree_0_node = degree_0_set.back();
+        const auto n = degree_0_set.back();
         degree_0_set.pop_back();
-        ordered.push_back(degree_0_node);
+        ordered.push_back(g.nodes[n]);
+        resolved[n] = true;
 
-        for (auto it = begin(graph); it!= end(graph);)
+        for (const auto m : g.dependees[n])
+            if (--g.in_degree[m] == 0)
+                degree_0_set.push_back(m);
+    }
+
+    return {.sorted=ordered, .error_set=g.errorSet(graph, resolved)};
+}
+
+///
+/// Partitions the nodes of `graph` into waves, such that all dependencies of the nodes in a wave
+/// are in earlier waves. The nodes of a wave are independent of each other. Wave `i` contains
+/// the nodes whose longest dependency chain has length `i`. The nodes of a wave are ordered.
+///
+template<class T>
+TopologicalWavesResult<T> topologicalWaves(const std::map<T, std::set<T>> &graph)
+{
+    detail::IndexedGraph<T> g(graph);
+
+    std::vector<size_t> wave;
+    for (size_t i = 0; i < g.nodes.size(); ++i)
+        if (g.in_degree[i] == 0)
+            wave.push_back(i);
+
+    std::vector<std::vector<T>> waves;
+    std::vector<bool> resolved(g.nodes.size(), false);
+    while (!wave.empty())
+    {
+        std::vector<size_t> next;
+        auto &nodes = waves.emplace_back();
+        nodes.reserve(wave.size());
+        for (const auto n : wave)
         {
-            auto &[node, edges] = *it;
-            if (edges.erase(degree_0_node) && edges.empty())
-            {
-                degree_0_set.push_back(node);
-                it = graph.erase(it);
-            }
-            else
-                ++it;
+            nodes.push_back(g.nodes[n]);
+            resolved[n] = true;
+            for (const auto m : g.dependees[n])
+                if (--g.in_degree[m] == 0)
+                    next.push_back(m);
         }
+
+        std::sort(next.begin(), next.end());
+        wave = std::move(next);
     }
-    return {.sorted=ordered, .error_set=graph};
-}
 
+    return {.waves=waves, .error_set=g.errorSet(graph, resolved)};
+}
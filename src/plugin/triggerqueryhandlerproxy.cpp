@@ -0,0 +1,58 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#include "triggerqueryhandlerproxy.h"
+using namespace albert;
+using namespace std;
+
+static const char *KEY_ID = "id";
+static const char *KEY_NAME = "name";
+static const char *KEY_DESCRIPTION = "description";
+static const char *KEY_SYNOPSIS = "synopsis";
+static const char *KEY_DEFAULT_TRIGGER = "default_trigger";
+static const char *KEY_ALLOW_TRIGGER_REMAP = "allow_trigger_remap";
+static const char *KEY_SUPPORTS_FUZZY = "supports_fuzzy";
+
+QVariantMap TriggerQueryHandlerProxy::record(const albert::TriggerQueryHandler *h)
+{
+    return {
+        {KEY_ID, h->id()},
+        {KEY_NAME, h->name()},
+        {KEY_DESCRIPTION, h->description()},
+        {KEY_SYNOPSIS, h->synopsis({})},
+        {KEY_DEFAULT_TRIGGER, h->defaultTrigger()},
+        {KEY_ALLOW_TRIGGER_REMAP, h->allowTriggerRemap()},
+        {KEY_SUPPORTS_FUZZY, h->supportsFuzzyMatching()}
+    };
+}
+
+TriggerQueryHandlerProxy::TriggerQueryHandlerProxy(const QVariantMap &r, function<void()> activate):
+    id_(r[KEY_ID].toString()),
+    name_(r[KEY_NAME].toString()),
+    description_(r[KEY_DESCRIPTION].toString()),
+    synopsis_(r[KEY_SYNOPSIS].toString()),
+    default_trigger_(r[KEY_DEFAULT_TRIGGER].toString()),
+    allow_trigger_remap_(r[KEY_ALLOW_TRIGGER_REMAP].toBool()),
+    supports_fuzzy_matching_(r[KEY_SUPPORTS_FUZZY].toBool()),
+    activate_(::move(activate))
+{}
+
+QString TriggerQueryHandlerProxy::id() const { return id_; }
+
+QString TriggerQueryHandlerProxy::name() const { return name_; }
+
+QString TriggerQueryHandlerProxy::description() const { return description_; }
+
+QString TriggerQueryHandlerProxy::synopsis(const QString &) const { return synopsis_; }
+
+bool TriggerQueryHandlerProxy::allowTriggerRemap() const { return allow_trigger_remap_; }
+
+QString TriggerQueryHandlerProxy::defaultTrigger() const { return default_trigger_; }
+
+bool TriggerQueryHandlerProxy::supportsFuzzyMatching() const { return supports_fuzzy_matching_; }
+
+void TriggerQueryHandlerProxy::handleTriggerQuery(Query &)
+{
+    // Activation replaces this handler, which invalidates the session and reruns the query.
+    if (!activated_.test_and_set())
+        activate_();
+}
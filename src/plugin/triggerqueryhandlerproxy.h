@@ -0,0 +1,45 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#pragma once
+#include "triggerqueryhandler.h"
+#include <QVariantMap>
+#include <atomic>
+#include <functional>
+
+///
+/// Stand-in for a trigger query handler of a plugin that is not loaded yet.
+///
+/// Built from metadata recorded when the plugin was loaded the last time. The first time the
+/// trigger is used, the activation function is called once, in the thread of the query.
+///
+class TriggerQueryHandlerProxy : public albert::TriggerQueryHandler
+{
+public:
+
+    /// Records the properties of `handler` needed to build a proxy.
+    static QVariantMap record(const albert::TriggerQueryHandler *handler);
+
+    TriggerQueryHandlerProxy(const QVariantMap &record, std::function<void()> activate);
+
+    QString id() const override;
+    QString name() const override;
+    QString description() const override;
+    QString synopsis(const QString &query) const override;
+    bool allowTriggerRemap() const override;
+    QString defaultTrigger() const override;
+    bool supportsFuzzyMatching() const override;
+    void handleTriggerQuery(albert::Query &) override;
+
+private:
+
+    const QString id_;
+    const QString name_;
+    const QString description_;
+    const QString synopsis_;
+    const QString default_trigger_;
+    const bool allow_trigger_remap_;
+    const bool supports_fuzzy_matching_;
+    const std::function<void()> activate_;
+    std::atomic_flag activated_;
+
+};
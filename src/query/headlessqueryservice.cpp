@@ -0,0 +1,112 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#include "extension.h"
+#include "headlessqueryservice.h"
+#include "item.h"
+#include "queryengine.h"
+#include "queryexecution.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+using namespace albert;
+using namespace std::chrono;
+using namespace std;
+
+static double toMilliseconds(microseconds d) { return d.count() / 1000.0; }
+
+static QJsonObject toJson(const ResultItem &result_item, size_t rank)
+{
+    return {
+        {"rank", (qint64)rank},
+        {"extension", result_item.extension.id()},
+        {"id", result_item.item->id()},
+        {"text", result_item.item->text()},
+        {"subtext", result_item.item->subtext()}
+    };
+}
+
+static QJsonArray toJson(const vector<ResultItem> &result_items)
+{
+    QJsonArray array;
+    for (size_t i = 0; i < result_items.size(); ++i)
+        array.append(toJson(result_items[i], i));
+    return array;
+}
+
+static QJsonArray toJson(const vector<QueryExecution::HandlerRuntime> &runtimes)
+{
+    QJsonArray array;
+    for (const auto &r : runtimes)
+    {
+        QJsonObject object{
+            {"id", r.id},
+            {"handling_ms", toMilliseconds(r.handling)},
+            {"count", (qint64)r.count}
+        };
+        if (r.scoring.count() >= 0)  // not applicable to triggered handlers
+            object.insert("scoring_ms", toMilliseconds(r.scoring));
+        array.append(object);
+    }
+    return array;
+}
+
+static QByteArray toLine(const QJsonObject &object)
+{ return QJsonDocument(object).toJson(QJsonDocument::Compact).append('\n'); }
+
+
+HeadlessQueryService::HeadlessQueryService(QueryEngine &engine) : engine_(engine) {}
+
+void HeadlessQueryService::run(const QString &string,
+                               Format format,
+                               function<bool(const QByteArray &)> write,
+                               function<void()> done) const
+{
+    auto *query = engine_.query(string).release();
+    const auto start = steady_clock::now();
+    auto written = make_shared<size_t>(0);  // matches written in JsonLines format
+
+    auto writeMatches = [=]
+    {
+        QByteArray chunk;
+        for (const auto &matches = query->matches(); *written < matches.size(); ++*written)
+        {
+            auto object = toJson(matches[*written], *written);
+            object.insert("type", "match");
+            chunk += toLine(object);
+        }
+        if (!chunk.isEmpty() && !write(chunk) && query->isValid())
+            query->cancel();  // receiver gone
+    };
+
+    if (format == Format::JsonLines)
+        QObject::connect(query, &Query::matchesAdded, query, writeMatches);
+
+    QObject::connect(query, &Query::activeChanged, query, [=](bool active)
+    {
+        if (active)
+            return;
+
+        QJsonObject summary{
+            {"query", string},
+            {"trigger", query->trigger()},
+            {"duration_ms", toMilliseconds(duration_cast<microseconds>(steady_clock::now() - start))},
+            {"handlers", toJson(query->handlerRuntimes())},
+            {"count", (qint64)query->matches().size()},
+            {"fallbacks", toJson(query->fallbacks())}
+        };
+
+        if (format == Format::JsonLines)
+        {
+            writeMatches();
+            summary.insert("type", "summary");
+        }
+        else
+            summary.insert("matches", toJson(query->matches()));
+
+        write(toLine(summary));
+        done();
+        query->deleteLater();
+    });
+
+    query->run();
+}
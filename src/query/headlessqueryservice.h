@@ -0,0 +1,43 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <functional>
+class QueryEngine;
+
+///
+/// Runs queries without a frontend and serializes the results as JSON.
+///
+/// The queries run through the regular QueryExecution path, i.e. they are handled, scored and
+/// ranked the same way as the queries of the frontend. The results contain the runtimes of the
+/// handlers involved.
+///
+class HeadlessQueryService
+{
+public:
+
+    enum class Format {
+        Json,       ///< A single document when the query finished.
+        JsonLines   ///< The matches as lines while they arrive, followed by a summary line.
+    };
+
+    explicit HeadlessQueryService(QueryEngine &engine);
+
+    ///
+    /// Runs `query`. Has to be called in the main thread.
+    ///
+    /// \param write Receives the output. Returns false if the receiver is gone, which cancels
+    ///              the query.
+    /// \param done Called when the query finished.
+    ///
+    void run(const QString &query,
+             Format format,
+             std::function<bool(const QByteArray &)> write,
+             std::function<void()> done) const;
+
+private:
+
+    QueryEngine &engine_;
+
+};
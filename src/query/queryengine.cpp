@@ -7,11 +7,13 @@
 #include "logging.h"
 #include "queryengine.h"
 #include "queryexecution.h"
+#include "settingsstore.h"
 #include "triggerqueryhandler.h"
 #include "usagedatabase.h"
 #include <QCoreApplication>
 #include <QMessageBox>
 #include <QSettings>
+using namespace albert::util;
 using namespace albert;
 using namespace std;
 static const char *CFG_GLOBAL_HANDLER_ENABLED = "global_handler_enabled";
@@ -29,10 +31,9 @@ QueryEngine::QueryEngine(ExtensionRegistry &registry) : registry_(registry)
     connect(&registry, &ExtensionRegistry::added, this, [this](Extension *e) {
         if (auto *th = dynamic_cast<albert::TriggerQueryHandler*>(e))
         {
-            auto s = settings();
-            s->beginGroup(th->id());
-            auto t = s->value(CFG_TRIGGER, th->defaultTrigger()).toString();
-            auto f = s->value(CFG_FUZZY, false).toBool();
+            SettingsGroup s(SettingsStore::config(), th->id());
+            auto t = s.value(CFG_TRIGGER, th->defaultTrigger()).toString();
+            auto f = s.value(CFG_FUZZY, false).toBool();
 
             th->setTrigger(t);
             th->setFuzzyMatching(f);
@@ -43,7 +44,7 @@ QueryEngine::QueryEngine(ExtensionRegistry &registry) : registry_(registry)
 
             if (auto *gh = dynamic_cast<albert::GlobalQueryHandler*>(th))
             {
-                auto en = settings()->value(QString("%1/%2")
+                auto en = SettingsStore::config().value(QString("%1/%2")
                                                 .arg(gh->id(), CFG_GLOBAL_HANDLER_ENABLED),
                                             true).toBool();
                 global_handlers_.emplace(piecewise_construct,
@@ -140,12 +141,12 @@ void QueryEngine::setTrigger(const QString &id, const QString& t)
     if (t.isEmpty() || t == h.handler->defaultTrigger())
     {
         h.trigger = h.handler->defaultTrigger();
-        settings()->remove(QString("%1/%2").arg(id, CFG_TRIGGER));
+        SettingsStore::config().remove(QString("%1/%2").arg(id, CFG_TRIGGER));
     }
     else
     {
         h.trigger = t;
-        settings()->setValue(QString("%1/%2").arg(id, CFG_TRIGGER), t);
+        SettingsStore::config().setValue(QString("%1/%2").arg(id, CFG_TRIGGER), t);
     }
 
     h.handler->setTrigger(h.trigger);
@@ -162,7 +163,7 @@ void QueryEngine::setFuzzy(const QString &id, bool f)
     if (h.handler->supportsFuzzyMatching())
     {
         h.fuzzy = f;
-        settings()->setValue(QString("%1/%2").arg(id, CFG_FUZZY), f);
+        SettingsStore::config().setValue(QString("%1/%2").arg(id, CFG_FUZZY), f);
         h.handler->setFuzzyMatching(f);
     }
 }
@@ -189,7 +190,7 @@ void QueryEngine::setEnabled(const QString &id, bool e)
 
     if (h.enabled != e)
     {
-        settings()->setValue(QString("%1/%2").arg(id, CFG_GLOBAL_HANDLER_ENABLED), e);
+        SettingsStore::config().setValue(QString("%1/%2").arg(id, CFG_GLOBAL_HANDLER_ENABLED), e);
         h.enabled = e;
     }
 }
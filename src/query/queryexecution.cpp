@@ -3,6 +3,8 @@
 #include "logging.h"
 #include "queryengine.h"
 #include "queryexecution.h"
+#include "querystatistics.h"
+#include "trace.h"
 #include "usagedatabase.h"
 #include <QCoreApplication>
 #include <QtConcurrentMap>
@@ -55,15 +57,34 @@ QueryExecution::~QueryExecution()
 
 void QueryExecution::run()
 {
+    TraceSpan span("QueryExecution::run", string_);
+    run_start_ = steady_clock::now();
+
     runFallbackHandlers();
 
     future_watcher_.setFuture(QtConcurrent::run([this](){
         try {
+            TraceSpan handler_span("handleTriggerQuery", query_handler_->id());
             auto tp = system_clock::now();
             query_handler_->handleTriggerQuery(*this);
+            const auto d = duration_cast<microseconds>(system_clock::now() - tp);
+
+            size_t count;
+            {
+                unique_lock lock(results_buffer_mutex_);
+                count = results_added_;
+            }
+            // Global queries record their handlers individually
+            if (dynamic_cast<QueryExecution*>(query_handler_) != this)
+            {
+                addHandlerRuntime({query_handler_->id(), d, microseconds(-1), count});
+                QueryStatistics::instance().addHandlerRuntime(query_handler_->id(), d,
+                                                              microseconds(-1), count);
+            }
+
             qCDebug(timeCat,).noquote()
                 << QStringLiteral("\x1b[38;5;33m│%1 ms│ TRIGGER |%2│ #%3  '%4' '%5' \x1b[0m")
-                       .arg(duration_cast<milliseconds>(system_clock::now() - tp).count(), 6)
+                       .arg(duration_cast<milliseconds>(d).count(), 6)
                        .arg(matches_.size(), 6)
                        .arg(query_id)
                        .arg(trigger_, string_);
@@ -159,11 +180,24 @@ void QueryExecution::notify(const Item *item)
         emit dataChanged(distance(matches_.begin(), it));
 }
 
+vector<QueryExecution::HandlerRuntime> QueryExecution::handlerRuntimes() const
+{
+    unique_lock lock(handler_runtimes_mutex_);
+    return handler_runtimes_;
+}
+
+void QueryExecution::addHandlerRuntime(HandlerRuntime runtime)
+{
+    unique_lock lock(handler_runtimes_mutex_);
+    handler_runtimes_.emplace_back(::move(runtime));
+}
+
 void QueryExecution::add(const shared_ptr<Item> &item)
 {
     unique_lock lock(results_buffer_mutex_);
 
     results_buffer_.emplace_back(*query_handler_, item);
+    ++results_added_;
 
     if (valid_)
         invokeCollectResults();
@@ -174,6 +208,7 @@ void QueryExecution::add(shared_ptr<Item> &&item)
     unique_lock lock(results_buffer_mutex_);
 
     results_buffer_.emplace_back(*query_handler_, ::move(item));
+    ++results_added_;
 
     if (valid_)
         invokeCollectResults();
@@ -185,6 +220,7 @@ void QueryExecution::add(const vector<shared_ptr<Item>> &items)
 
     for (const auto &item : items)
         results_buffer_.emplace_back(*query_handler_, item);
+    results_added_ += items.size();
 
     if (valid_)
         invokeCollectResults();
@@ -194,6 +230,7 @@ void QueryExecution::add(vector<shared_ptr<Item>> &&items)
 {
     unique_lock lock(results_buffer_mutex_);
 
+    results_added_ += items.size();
     for (auto &item : items)
         results_buffer_.emplace_back(*query_handler_, ::move(item));
 
@@ -203,6 +240,8 @@ void QueryExecution::add(vector<shared_ptr<Item>> &&items)
 
 void QueryExecution::invokeCollectResults()
 {
+    if (collect_queued_ < 0 && Trace::isEnabled())
+        collect_queued_ = Trace::now();
     QMetaObject::invokeMethod(this, &QueryExecution::collectResults, Qt::QueuedConnection);
 }
 
@@ -215,11 +254,14 @@ void QueryExecution::runFallbackHandlers()
 
     vector<pair<Extension*,RankItem>> fallbacks;
     for (auto *handler : fallback_handlers_)
+    {
+        TraceSpan span("fallbacks", handler->id());
         for (auto item : handler->fallbacks(QString("%1%2").arg(trigger(), string())))
             if (auto it = o.find(make_pair(handler->id(), item->id())); it == o.end())
                 fallbacks.emplace_back(handler, RankItem(::move(item), 0));
             else
                 fallbacks.emplace_back(handler, RankItem(::move(item), it->second));
+    }
 
     sort(fallbacks.begin(), fallbacks.end(),
          [](const auto &a, const auto &b){ return a.second.score > b.second.score; });
@@ -236,8 +278,20 @@ void QueryExecution::collectResults()
     // messes up the frontend state machines. So we collect the results in
     // the main thread using a buffer.
     unique_lock lock(results_buffer_mutex_);
+
+    TraceSpan span("collectResults",
+                   collect_queued_ < 0 ? QString()
+                                       : QStringLiteral("%1 items, queued %2 µs")
+                                             .arg(results_buffer_.size())
+                                             .arg(Trace::now() - collect_queued_));
+    collect_queued_ = -1;
+
     if (!results_buffer_.empty())
     {
+        if (matches_.empty())
+            QueryStatistics::instance().addTimeToFirstResult(
+                duration_cast<microseconds>(steady_clock::now() - run_start_));
+
         emit matchesAboutToBeAdded(results_buffer_.size());
 
         matches_.reserve(matches_.size() + results_buffer_.size());
@@ -304,17 +358,26 @@ void GlobalQuery::handleTriggerQuery(Query &)
             auto t = system_clock::now();
 
             vector<RankItem> results;
-            if (string_.isNull())
-                for (auto &item : handler->handleEmptyQuery())
-                    results.emplace_back(::move(item), 0);
-            else
-                results = handler->handleGlobalQuery(*this);
+            {
+                TraceSpan span("handleGlobalQuery", handler->id());
+                if (string_.isNull())
+                    for (auto &item : handler->handleEmptyQuery())
+                        results.emplace_back(::move(item), 0);
+                else
+                    results = handler->handleGlobalQuery(*this);
+            }
 
-            auto d_h = duration_cast<milliseconds>(system_clock::now()-t).count();
+            const auto d_h = duration_cast<microseconds>(system_clock::now()-t);
 
             t = system_clock::now();
-            handler->applyUsageScore(&results);
-            auto d_s = duration_cast<milliseconds>(system_clock::now()-t).count();
+            {
+                TraceSpan span("applyUsageScore", handler->id());
+                handler->applyUsageScore(&results);
+            }
+            const auto d_s = duration_cast<microseconds>(system_clock::now()-t);
+
+            addHandlerRuntime({handler->id(), d_h, d_s, results.size()});
+            QueryStatistics::instance().addHandlerRuntime(handler->id(), d_h, d_s, results.size());
 
             // makes no sense to time this, since waiting for unlock
             unique_lock lock(rank_items_mutex);
@@ -324,8 +387,8 @@ void GlobalQuery::handleTriggerQuery(Query &)
 
             qCDebug(timeCat,).noquote()
                 << QStringLiteral("\x1b[38;5;244m│%1 ms│%2 ms│%3│ #%4 '%5' %6\x1b[0m")
-                       .arg(d_h, 6)
-                       .arg(d_s, 6)
+                       .arg(duration_cast<milliseconds>(d_h).count(), 6)
+                       .arg(duration_cast<milliseconds>(d_s).count(), 6)
                        .arg(results.size(), 6)
                        .arg(query_id)
                        .arg(string_, handler->id());
@@ -350,20 +413,23 @@ void GlobalQuery::handleTriggerQuery(Query &)
     };
 
     tp = system_clock::now();
-    auto begin = ::begin(rank_items);
-    auto end = ::end(rank_items);
-    auto mid = begin + 20;
-
-    // Partially sort the visible items for fast response times
-    if (mid < end)
     {
-        partial_sort(begin, mid, end, cmp);
-        addRankItems(begin, mid);
-        begin = mid;
-    }
+        TraceSpan span("sort");
+        auto begin = ::begin(rank_items);
+        auto end = ::end(rank_items);
+        auto mid = begin + 20;
+
+        // Partially sort the visible items for fast response times
+        if (mid < end)
+        {
+            partial_sort(begin, mid, end, cmp);
+            addRankItems(begin, mid);
+            begin = mid;
+        }
 
-    sort(begin, end, cmp);
-    addRankItems(begin, end);
+        sort(begin, end, cmp);
+        addRankItems(begin, end);
+    }
 
     auto d_s = duration_cast<milliseconds>(system_clock::now()-tp).count();
 
@@ -385,6 +451,7 @@ void GlobalQuery::addRankItems(vector<pair<Extension*,RankItem>>::iterator begin
 
     for (auto it = begin; it < end; ++it)
         results_buffer_.emplace_back(*it->first, ::move(it->second.item));
+    results_added_ += end - begin;
 
     if (valid_)
         invokeCollectResults();
@@ -6,6 +6,8 @@
 #include "query.h"
 #include "triggerqueryhandler.h"
 #include <QFutureWatcher>
+#include <chrono>
+#include <mutex>
 namespace albert { class Item; }
 class QueryEngine;
 
@@ -49,8 +51,21 @@ public:
 
     void notify(const albert::Item*) override;
 
+    struct HandlerRuntime
+    {
+        QString id;
+        std::chrono::microseconds handling;
+        std::chrono::microseconds scoring;  // Usage scoring of global handlers, negative else
+        size_t count;
+    };
+
+    /// The runtimes of the handlers involved. Complete when the query is no longer active.
+    std::vector<HandlerRuntime> handlerRuntimes() const;
+
 protected:
 
+    void addHandlerRuntime(HandlerRuntime runtime);
+
     void runFallbackHandlers();
     void invokeCollectResults();
     Q_INVOKABLE void collectResults();
@@ -68,11 +83,17 @@ protected:
 
     bool valid_ = true;
     bool active_ = false;
+    std::chrono::steady_clock::time_point run_start_;
 
     QFutureWatcher<void> future_watcher_;
 
     std::vector<albert::ResultItem> results_buffer_;
     std::mutex results_buffer_mutex_;
+    size_t results_added_ = 0;  // guarded by results_buffer_mutex_
+    qint64 collect_queued_ = -1;  // trace time of the first pending collect, guarded by results_buffer_mutex_
+
+    std::vector<HandlerRuntime> handler_runtimes_;
+    mutable std::mutex handler_runtimes_mutex_;
 
 private:
 
@@ -0,0 +1,136 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#include "querystatistics.h"
+#include <QStringList>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <mutex>
+using namespace std::chrono;
+using namespace std;
+
+// The highest bucket group covers values with (groups + sub bucket bits - 1) bits
+static constexpr int value_bits = (Histogram::bucket_count >> Histogram::sub_bucket_bits)
+                                  + Histogram::sub_bucket_bits - 1;
+static constexpr uint64_t max_value = (uint64_t{1} << value_bits) - 1;
+
+int Histogram::bucketIndex(uint64_t value)
+{
+    value = min(value, max_value);
+    if (value < (1u << sub_bucket_bits))
+        return (int)value;
+
+    const int shift = bit_width(value) - 1 - sub_bucket_bits;
+    return ((shift + 1) << sub_bucket_bits) + (int)((value >> shift) - (1u << sub_bucket_bits));
+}
+
+uint64_t Histogram::bucketUpperBound(int index)
+{
+    if (index < (1 << sub_bucket_bits))
+        return index;
+
+    const int shift = (index >> sub_bucket_bits) - 1;
+    const uint64_t lower = (uint64_t)((index & ((1 << sub_bucket_bits) - 1)) + (1 << sub_bucket_bits)) << shift;
+    return lower + (uint64_t{1} << shift) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{ buckets_[bucketIndex(value)].fetch_add(1, memory_order_relaxed); }
+
+uint64_t Histogram::count() const
+{
+    uint64_t n = 0;
+    for (const auto &b : buckets_)
+        n += b.load(memory_order_relaxed);
+    return n;
+}
+
+uint64_t Histogram::percentile(double p) const
+{
+    array<uint64_t, bucket_count> snapshot;
+    uint64_t total = 0;
+    for (int i = 0; i < bucket_count; ++i)
+        total += snapshot[i] = buckets_[i].load(memory_order_relaxed);
+
+    if (total == 0)
+        return 0;
+
+    const auto rank = max<uint64_t>(1, (uint64_t)ceil(clamp(p, 0.0, 100.0) / 100.0 * total));
+    uint64_t cumulative = 0;
+    for (int i = 0; i < bucket_count; ++i)
+        if (cumulative += snapshot[i]; cumulative >= rank)
+            return bucketUpperBound(i);
+    return bucketUpperBound(bucket_count - 1);
+}
+
+
+QueryStatistics &QueryStatistics::instance()
+{
+    static QueryStatistics instance;
+    return instance;
+}
+
+void QueryStatistics::addHandlerRuntime(const QString &id, microseconds handling,
+                                        microseconds scoring, size_t results)
+{
+    HandlerStatistics *s;
+    {
+        shared_lock lock(mutex_);
+        auto it = handlers_.find(id);
+        s = it == handlers_.end() ? nullptr : it->second.get();
+    }
+
+    if (!s)
+    {
+        unique_lock lock(mutex_);
+        auto &p = handlers_[id];
+        if (!p)
+            p = make_unique<HandlerStatistics>();
+        s = p.get();
+    }
+
+    s->handling.record(handling.count());
+    if (scoring.count() >= 0)
+        s->scoring.record(scoring.count());
+    s->results.record(results);
+}
+
+void QueryStatistics::addTimeToFirstResult(microseconds duration)
+{ time_to_first_result_.record(duration.count()); }
+
+const QueryStatistics::HandlerStatistics *QueryStatistics::handler(const QString &id) const
+{
+    shared_lock lock(mutex_);
+    auto it = handlers_.find(id);
+    return it == handlers_.end() ? nullptr : it->second.get();
+}
+
+const Histogram &QueryStatistics::timeToFirstResult() const { return time_to_first_result_; }
+
+map<QString, const QueryStatistics::HandlerStatistics *> QueryStatistics::handlers() const
+{
+    shared_lock lock(mutex_);
+    map<QString, const HandlerStatistics*> m;
+    for (const auto &[id, s] : handlers_)
+        m.emplace(id, s.get());
+    return m;
+}
+
+QString QueryStatistics::latencySummary(const Histogram &h)
+{
+    QStringList l;
+    for (auto p : {50., 95., 99.})
+    {
+        const auto ms = h.percentile(p) / 1000.;
+        l << QString::number(ms, 'f', ms < 10. ? 1 : 0);
+    }
+    return QStringLiteral("%1 ms").arg(l.join(u'/'));
+}
+
+QString QueryStatistics::countSummary(const Histogram &h)
+{
+    QStringList l;
+    for (auto p : {50., 95., 99.})
+        l << QString::number(h.percentile(p));
+    return l.join(u'/');
+}
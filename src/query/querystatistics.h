@@ -0,0 +1,90 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+
+///
+/// Lock-free histogram with logarithmic buckets of linear sub-buckets (HDR style).
+///
+/// Values are bucketed with a relative error of at most 1/32. Values exceeding 2^36 are clamped.
+///
+class Histogram
+{
+public:
+
+    static constexpr int sub_bucket_bits = 5;
+    static constexpr int bucket_count = 32 << sub_bucket_bits;
+
+    void record(uint64_t value);
+
+    /// Returns the number of recorded values.
+    uint64_t count() const;
+
+    /// Returns the upper bound of the bucket containing the `p`th percentile, `p` in [0, 100].
+    /// Returns 0 if the histogram is empty.
+    uint64_t percentile(double p) const;
+
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+
+    std::array<std::atomic<uint64_t>, bucket_count> buckets_{};
+
+};
+
+
+///
+/// Process-wide query performance counters.
+///
+class QueryStatistics
+{
+public:
+
+    struct HandlerStatistics
+    {
+        Histogram handling;  ///< µs
+        Histogram scoring;   ///< µs, global queries only
+        Histogram results;   ///< result count
+    };
+
+    static QueryStatistics &instance();
+
+    /// Records a run of the handler `id`. `scoring` is negative for triggered queries.
+    void addHandlerRuntime(const QString &id,
+                           std::chrono::microseconds handling,
+                           std::chrono::microseconds scoring,
+                           size_t results);
+
+    /// Records the time from the start of a query until its first results were added.
+    void addTimeToFirstResult(std::chrono::microseconds duration);
+
+    /// Returns the statistics of handler `id` or nullptr if there are none yet.
+    const HandlerStatistics *handler(const QString &id) const;
+
+    const Histogram &timeToFirstResult() const;
+
+    /// Returns the statistics of all handlers, sorted by id.
+    std::map<QString, const HandlerStatistics*> handlers() const;
+
+    /// Returns p50/p95/p99 of a µs histogram as human readable string, e.g. "1.2/3.4/12 ms".
+    static QString latencySummary(const Histogram &);
+
+    /// Returns p50/p95/p99 of a count histogram as human readable string, e.g. "10/25/70".
+    static QString countSummary(const Histogram &);
+
+private:
+
+    QueryStatistics() = default;
+
+    mutable std::shared_mutex mutex_;  // guards the map, not the histograms
+    std::map<QString, std::unique_ptr<HandlerStatistics>> handlers_;
+    Histogram time_to_first_result_;
+
+};
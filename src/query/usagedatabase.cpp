@@ -4,17 +4,18 @@
 #include "extension.h"
 #include "logging.h"
 #include "rankitem.h"
+#include "settingsstore.h"
 #include "usagedatabase.h"
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
-#include <QSettings>
 #include <QSqlDriver>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QTimer>
 #include <mutex>
 #include <shared_mutex>
+using namespace albert::util;
 using namespace albert;
 using namespace std;
 
@@ -48,9 +49,9 @@ void UsageHistory::initialize()
     db_connect();
     db_initialize();
 
-    auto s = settings();
-    memory_decay_ = s->value(CFG_MEMORY_DECAY, DEF_MEMORY_DECAY).toDouble();
-    prioritize_perfect_match_ = s->value(CFG_PRIO_PERFECT, DEF_PRIO_PERFECT).toBool();
+    const auto &s = SettingsStore::config();
+    memory_decay_ = s.value(CFG_MEMORY_DECAY, DEF_MEMORY_DECAY).toDouble();
+    prioritize_perfect_match_ = s.value(CFG_PRIO_PERFECT, DEF_PRIO_PERFECT).toBool();
 
     updateScores();
 }
@@ -106,7 +107,7 @@ double UsageHistory::memoryDecay()
 
 void UsageHistory::setMemoryDecay(double value)
 {
-    settings()->setValue(CFG_MEMORY_DECAY, value);
+    SettingsStore::config().setValue(CFG_MEMORY_DECAY, value);
 
     global_data_mutex_.lock();
     memory_decay_ = value;
@@ -123,7 +124,7 @@ bool UsageHistory::prioritizePerfectMatch()
 
 void UsageHistory::setPrioritizePerfectMatch(bool value)
 {
-    settings()->setValue(CFG_PRIO_PERFECT, value);
+    SettingsStore::config().setValue(CFG_PRIO_PERFECT, value);
     unique_lock lock(global_data_mutex_);
     prioritize_perfect_match_ = value;
 }
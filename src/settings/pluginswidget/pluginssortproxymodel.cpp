@@ -2,7 +2,8 @@
 
 #include "albert.h"
 #include "pluginssortproxymodel.h"
-#include <QSettings>
+#include "settingsstore.h"
+using namespace albert::util;
 using namespace albert;
 const char* CFG_SORT_MODE = "show_enabled_plugins_first";
 const bool  DEF_SORT_MODE = true;
@@ -10,7 +11,7 @@ const bool  DEF_SORT_MODE = true;
 
 PluginsSortProxyModel::PluginsSortProxyModel(QObject *parent) : QSortFilterProxyModel(parent)
 {
-    show_enabled_first_ = settings()->value(CFG_SORT_MODE, DEF_SORT_MODE).toBool();
+    show_enabled_first_ = SettingsStore::config().value(CFG_SORT_MODE, DEF_SORT_MODE).toBool();
 }
 
 bool PluginsSortProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
@@ -32,7 +33,7 @@ void PluginsSortProxyModel::setShowEnabledFirst(bool value)
     if (value != show_enabled_first_)
     {
         show_enabled_first_ = value;
-        settings()->setValue(CFG_SORT_MODE, show_enabled_first_);
+        SettingsStore::config().setValue(CFG_SORT_MODE, show_enabled_first_);
         invalidate();
         sort(0);
     }
@@ -3,6 +3,7 @@
 #include "globalqueryhandler.h"
 #include "queryengine.h"
 #include "queryhandlermodel.h"
+#include "querystatistics.h"
 #include "triggerqueryhandler.h"
 #include <QCoreApplication>
 #include <QHeaderView>
@@ -12,8 +13,8 @@ using namespace albert;
 using namespace std;
 
 namespace {
-enum class Column { Name, Trigger, Global, Fuzzy };
-static int column_count = 4;
+enum class Column { Name, Trigger, Global, Fuzzy, Latency };
+static int column_count = 5;
 }
 
 
@@ -39,6 +40,13 @@ void QueryHandlerModel::updateHandlers()
     endResetModel();
 }
 
+void QueryHandlerModel::updateStatistics()
+{
+    if (!handlers_.empty())
+        emit dataChanged(index(0, (int) Column::Latency),
+                         index((int) handlers_.size() - 1, (int) Column::Latency));
+}
+
 int QueryHandlerModel::rowCount(const QModelIndex&) const
 { return handlers_.size(); }
 
@@ -122,6 +130,26 @@ QVariant QueryHandlerModel::data(const QModelIndex &idx, int role) const
         }
     }
 
+    else if (idx.column() == (int) Column::Latency)
+    {
+        if (const auto *s = QueryStatistics::instance().handler(h->id()); s)
+        {
+            if (role == Qt::DisplayRole)
+                return QueryStatistics::latencySummary(s->handling);
+
+            else if (role == Qt::ToolTipRole)
+            {
+                auto t = tr("Handling: %1\nResults: %2\nQueries: %3")
+                             .arg(QueryStatistics::latencySummary(s->handling),
+                                  QueryStatistics::countSummary(s->results))
+                             .arg(s->handling.count());
+                if (s->scoring.count() > 0)
+                    t += tr("\nUsage scoring: %1").arg(QueryStatistics::latencySummary(s->scoring));
+                return t;
+            }
+        }
+    }
+
     return {};
 }
 
@@ -177,6 +205,7 @@ QVariant QueryHandlerModel::headerData(int section, Qt::Orientation orientation,
         case Column::Trigger: return tr("Trigger");
         case Column::Global: return tr("G", "short Global");
         case Column::Fuzzy: return tr("F", "short Fuzzy");
+        case Column::Latency: return tr("Latency");
         }
     else if (role == Qt::ToolTipRole)
         switch ((Column) section) {
@@ -184,6 +213,8 @@ QVariant QueryHandlerModel::headerData(int section, Qt::Orientation orientation,
         case Column::Trigger: return tr("The trigger of the handler. Spaces are visualized by •.");
         case Column::Global: return tr("Enabled global query handlers.");
         case Column::Fuzzy: return tr("Fuzzy matching.");
+        case Column::Latency: return tr("50th/95th/99th percentile of the handling time "
+                                        "since startup.");
         }
     return {};
 }
@@ -201,6 +232,8 @@ Qt::ItemFlags QueryHandlerModel::flags(const QModelIndex &idx) const
         return dynamic_cast<GlobalQueryHandler*>(h) ? Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable : Qt::NoItemFlags;
     case Column::Fuzzy:
         return h->supportsFuzzyMatching() ? Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable : Qt::NoItemFlags;
+    case Column::Latency:
+        return Qt::ItemIsEnabled;
     }
     return {};
 }
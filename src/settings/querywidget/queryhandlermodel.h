@@ -13,6 +13,9 @@ public:
 
     explicit QueryHandlerModel(QueryEngine &qe, QObject *parent);
 
+    /// Refreshes the performance statistics columns.
+    void updateStatistics();
+
 private:
 
     void updateHandlers();
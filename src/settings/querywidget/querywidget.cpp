@@ -19,7 +19,7 @@ QueryWidget::QueryWidget(QueryEngine &qe)
     QObject::connect(ui.checkBox_prioritizePerfectMatch, &QCheckBox::toggled, this,
                      [](bool val){ UsageHistory::setPrioritizePerfectMatch(val); });
 
-    ui.tableView_queryHandlers->setModel(new QueryHandlerModel(qe, this)); // Takes ownership
+    ui.tableView_queryHandlers->setModel(query_handler_model_ = new QueryHandlerModel(qe, this)); // Takes ownership
     ui.tableView_fallbackOrder->setModel(fallbacks_model_ = new FallbacksModel(qe, this)); // Takes ownership
 
     for (auto *tv : {ui.tableView_queryHandlers, ui.tableView_fallbackOrder})
@@ -53,4 +53,5 @@ void QueryWidget::showEvent(QShowEvent*)
     // signal in FallbackHandler and connect change the fallbacksmodel to
     // listen to it. That would be a lot of overhead for a very simple thing.
     fallbacks_model_->updateFallbackList();
+    query_handler_model_->updateStatistics();
 }
@@ -5,6 +5,7 @@
 #include <QWidget>
 class QueryEngine;
 class FallbacksModel;
+class QueryHandlerModel;
 
 class QueryWidget : public QWidget
 {
@@ -18,5 +19,6 @@ private:
 
     Ui::QueryWidget ui;
     FallbacksModel *fallbacks_model_;
+    QueryHandlerModel *query_handler_model_;
 
 };
@@ -3,9 +3,11 @@
 #include "albert.h"
 #include "app.h"
 #include "frontend.h"
+#include "settingsstore.h"
 #include <QCoreApplication>
 #include <QSettings>
 #include <QStandardPaths>
+using namespace albert::util;
 using namespace std;
 
 
@@ -34,14 +36,31 @@ filesystem::path albert::configLocation()
 filesystem::path albert::dataLocation()
 { return getFilesystemPath(QStandardPaths::AppDataLocation); }
 
-inline static unique_ptr<QSettings> settingsFromPath(const filesystem::path &path)
-{ return make_unique<QSettings>(path.string().data(), QSettings::IniFormat); }
+namespace {
+// Keeps the store coherent with changes made using QSettings. The file is reread only if
+// the object changed it. Pending changes of the store are written before the object is
+// created, i.e. the object sees them and they are not reapplied over its changes on reload.
+class StoreSettings : public QSettings
+{
+public:
+    StoreSettings(SettingsStore &store) : QSettings(store.fileName(), QSettings::IniFormat), store_(store) {}
+    ~StoreSettings() override { sync(); store_.reload(); }
+private:
+    SettingsStore &store_;
+};
+}
+
+inline static unique_ptr<QSettings> settingsFromStore(SettingsStore &store)
+{
+    store.sync();  // no-op if nothing is pending
+    return make_unique<StoreSettings>(store);
+}
 
 unique_ptr<QSettings> albert::settings()
-{ return settingsFromPath(configLocation() / "config"); }
+{ return settingsFromStore(SettingsStore::config()); }
 
 unique_ptr<QSettings> albert::state()
-{ return settingsFromPath(cacheLocation() / "state"); }
+{ return settingsFromStore(SettingsStore::state()); }
 
 void albert::showSettings(QString plugin_id)
 { App::instance()->showSettings(plugin_id); }
@@ -0,0 +1,213 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#include "asyncpixmaploader.h"
+#include "iconprovider.h"
+#include "imagefromurl.h"
+#include "pixmapcache.h"
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include <limits>
+#include <map>
+using namespace albert::util;
+using namespace std;
+
+class AsyncPixmapLoader::Private
+{
+public:
+
+    struct Request
+    {
+        QStringList urls;
+        QSize size;
+        qreal dpr;
+        bool high_priority;
+        shared_ptr<atomic_bool> cancelled;
+    };
+
+    struct Result
+    {
+        int row;
+        Request request;
+        qsizetype url_index;  // index of the url that yielded the image or the fallback
+        QImage image;
+        bool fallback;
+    };
+
+    AsyncPixmapLoader *q;
+    QPixmap placeholder;
+    QThreadPool pool;
+    map<int, Request> pending;
+    int first_visible = 0;
+    int last_visible = numeric_limits<int>::max();
+
+    bool isVisible(int row) const { return first_visible <= row && row <= last_visible; }
+
+    void schedule(int row, Request request)
+    {
+        request.high_priority = isVisible(row);
+        request.cancelled = make_shared<atomic_bool>(false);
+        const auto priority = request.high_priority ? 1 : 0;
+
+        pool.start([q=q, row, r=request]
+        {
+            for (qsizetype i = 0; i < r.urls.size(); ++i)
+            {
+                if (*r.cancelled)
+                    return;
+
+                if (auto image = imageFromUrl(r.urls[i], r.size * r.dpr); !image)
+                {
+                    QMetaObject::invokeMethod(q, [=]{ q->d->finish({row, r, i, {}, true}); },
+                                              Qt::QueuedConnection);
+                    return;
+                }
+                else if (!image->isNull())
+                {
+                    QMetaObject::invokeMethod(q, [=, img=::move(*image)]{ q->d->finish({row, r, i, img, false}); },
+                                              Qt::QueuedConnection);
+                    return;
+                }
+            }
+
+            QMetaObject::invokeMethod(q, [=]{ q->d->finish({row, r, r.urls.size(), {}, false}); },
+                                      Qt::QueuedConnection);
+        }, priority);
+
+        pending[row] = ::move(request);
+    }
+
+    void finish(Result result)
+    {
+        auto &cache = PixmapCache::instance();
+        const auto &r = result.request;
+
+        // Cache what has been resolved, even if the request has been superseded meanwhile
+        for (qsizetype i = 0; i < result.url_index; ++i)
+            cache.insert({r.urls[i], r.size, r.dpr}, {});
+
+        QPixmap pm;
+        if (!result.fallback && result.url_index < r.urls.size())
+        {
+            pm = QPixmap::fromImage(::move(result.image));
+            pm.setDevicePixelRatio(r.dpr);
+            cache.insert({r.urls[result.url_index], r.size, r.dpr}, pm);
+        }
+
+        if (auto it = pending.find(result.row);
+            it == pending.end() || it->second.cancelled != r.cancelled)
+            return;  // cancelled or superseded
+        else
+            pending.erase(it);
+
+        if (result.fallback)
+            for (auto i = result.url_index; i < r.urls.size(); ++i)
+                if (pm = pixmapFromUrl(r.urls[i], r.size, r.dpr); !pm.isNull())
+                    break;
+
+        emit q->pixmapReady(result.row, pm);
+    }
+};
+
+
+AsyncPixmapLoader::AsyncPixmapLoader(QObject *parent):
+    QObject(parent),
+    d(make_unique<Private>())
+{
+    d->q = this;
+    d->pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+}
+
+AsyncPixmapLoader::~AsyncPixmapLoader()
+{
+    cancelAll();
+    d->pool.waitForDone();
+}
+
+const QPixmap &AsyncPixmapLoader::placeholder() const { return d->placeholder; }
+
+void AsyncPixmapLoader::setPlaceholder(const QPixmap &pm) { d->placeholder = pm; }
+
+int AsyncPixmapLoader::maxThreadCount() const { return d->pool.maxThreadCount(); }
+
+void AsyncPixmapLoader::setMaxThreadCount(int count) { d->pool.setMaxThreadCount(count); }
+
+QPixmap AsyncPixmapLoader::request(int row, const QStringList &urls, const QSize &size, qreal dpr)
+{
+    // Serve from cache if the outcome is known already
+    bool resolved = true;
+    for (const auto &url : urls)
+    {
+        if (auto pm = PixmapCache::instance().lookup({url, size, dpr}); !pm)
+        {
+            resolved = false;
+            break;
+        }
+        else if (!pm->isNull())
+        {
+            cancel(row);
+            return *pm;
+        }
+    }
+
+    if (resolved)  // none of the urls yields a pixmap
+    {
+        cancel(row);
+        return {};
+    }
+
+    if (auto it = d->pending.find(row); it != d->pending.end())
+    {
+        if (const auto &r = it->second; r.urls == urls && r.size == size && r.dpr == dpr)
+            return d->placeholder;  // already pending
+        else
+        {
+            *r.cancelled = true;
+            d->pending.erase(it);
+        }
+    }
+
+    d->schedule(row, {.urls = urls, .size = size, .dpr = dpr, .high_priority = false, .cancelled = {}});
+    return d->placeholder;
+}
+
+void AsyncPixmapLoader::setVisibleRows(int first, int last)
+{
+    d->first_visible = first;
+    d->last_visible = last;
+
+    for (auto it = d->pending.begin(); it != d->pending.end();)
+    {
+        auto &[row, r] = *it;
+        if (!d->isVisible(row))
+        {
+            *r.cancelled = true;
+            it = d->pending.erase(it);
+        }
+        else
+        {
+            if (!r.high_priority)  // requeue with high priority
+            {
+                *r.cancelled = true;
+                d->schedule(row, r);
+            }
+            ++it;
+        }
+    }
+}
+
+void AsyncPixmapLoader::cancel(int row)
+{
+    if (auto it = d->pending.find(row); it != d->pending.end())
+    {
+        *it->second.cancelled = true;
+        d->pending.erase(it);
+    }
+}
+
+void AsyncPixmapLoader::cancelAll()
+{
+    for (auto &[row, r] : d->pending)
+        *r.cancelled = true;
+    d->pending.clear();
+}
@@ -1,14 +1,19 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #include "iconprovider.h"
+#include "imagefromurl.h"
 #include "logging.h"
+#include "pixmapcache.h"
+#include "trace.h"
 #include <QApplication>
 #include <QFileIconProvider>
 #include <QIconEngine>
+#include <QImageReader>
 #include <QMetaEnum>
 #include <QPainter>
 #include <QString>
 #include <QStyle>
+#include <QStyleOption>
 #include <QUrlQuery>
 #if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
 #include "iconlookup.h"
@@ -28,16 +33,6 @@ static const QString &xdg_icon_lookup_scheme   = u"xdg:"_s;
 static const QString &compose_lookup_scheme    = u"comp:?"_s;
 static const QString &mask_lookup_scheme       = u"mask:?"_s;
 
-/// Returns a pixmap from a file path.
-/// The size of the pixmap may be smaller but never larger than the requested size.
-static QPixmap pixmapFromFilePath(const QString &path, const QSize &requestedSize)
-{
-    if (auto pm = QPixmap(path);
-        pm.width() > requestedSize.width() || pm.height() > requestedSize.height())
-        return pm.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    else
-        return pm;
-}
 
 static QIcon standardIconFromName(const QString &enumerator_name)
 {
@@ -54,9 +49,69 @@ static QIcon standardIconFromName(const QString &enumerator_name)
 QString util::xdgIconLookup(const QString &name)
 {
     // https://specifications.freedesktop.org/icon-theme-spec/icon-theme-spec-latest.html
-    return XDG::IconLookup::iconPath(name);
+    return XDG::IconLookup::iconPath(name, {}, PixmapCache::instance().themeName());
 }
+
+QString util::xdgIconLookup(const QString &name, const QSize &size)
+{
+    // Thread-safe, the theme name is maintained in the GUI thread
+    return XDG::IconLookup::iconPath(name, size, PixmapCache::instance().themeName());
+}
+#endif
+
+/// Decodes image files, downscaling while decoding if the image is larger than requested.
+/// Renders vector graphics at the requested size.
+static QImage readImage(const QString &path, const QSize &requestedSize)
+{
+    QImageReader reader(path);
+    if (!reader.canRead())
+        return {};
+
+    // Vector graphics are rendered at the requested size
+    if (const auto size = reader.size();
+        size.isValid() && (reader.format().startsWith("svg")
+                           || size.width() > requestedSize.width()
+                           || size.height() > requestedSize.height()))
+        reader.setScaledSize(size.scaled(requestedSize, Qt::KeepAspectRatio));
+
+    auto image = reader.read();
+    if (image.width() > requestedSize.width() || image.height() > requestedSize.height())
+        image = image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    return image;
+}
+
+optional<QImage> util::imageFromUrl(const QString &url, const QSize &requestedSize)
+{
+    if (url.startsWith(implicit_qrc_scheme))
+        return readImage(url, requestedSize);  // intended, colon has to remain
+
+    else if (url.startsWith(explicit_qrc_scheme))
+        return readImage(url.mid(explicit_qrc_scheme.size()-1), requestedSize);  // intended, colon has to remain
+
+    else if (url.startsWith(file_scheme))
+        return readImage(url.mid(file_scheme.size()), requestedSize);
+
+    else if (url.startsWith(xdg_icon_lookup_scheme))
+    {
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+        // Leave misses to the Qt theme lookup in the GUI thread
+        if (const auto path = xdgIconLookup(url.mid(xdg_icon_lookup_scheme.size()), requestedSize);
+            !path.isNull())
+            return readImage(path, requestedSize);
 #endif
+        return nullopt;
+    }
+
+    else if (url.startsWith(qfileiconprovider_scheme)
+             || url.startsWith(qstandardpixmap_scheme)
+             || url.startsWith(generative_scheme)
+             || url.startsWith(mask_lookup_scheme)
+             || url.startsWith(compose_lookup_scheme))
+        return nullopt;
+
+    // Implicitly check for file existence
+    return readImage(url, requestedSize);
+}
 
 QIcon util::fileIcon(const QString &path)
 {
@@ -135,20 +190,57 @@ struct GenericIconEngine : public QIconEngine
 
 };
 
-QPixmap util::pixmapFromUrl(const QString &url, const QSize &requestedSize)
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+/// Looks up the icon file per requested size, i.e. uses the sizes provided by the theme.
+/// Pixmaps are rendered using pixmapFromUrl, i.e. they are cached.
+struct XdgIconEngine : public QIconEngine
 {
-    if (url.startsWith(implicit_qrc_scheme))
-        return pixmapFromFilePath(url, requestedSize);  // intended, colon has to remain
+    QString name_;
 
-    else if (url.startsWith(explicit_qrc_scheme))
-        return pixmapFromFilePath(url.mid(explicit_qrc_scheme.size()-1), requestedSize);  // intended, colon has to remain
+    XdgIconEngine(const QString &name) : name_(name) {}
+
+    virtual void paint(QPainter *p, const QRect &rect, QIcon::Mode mode, QIcon::State state) override
+    {
+        const auto dpr = p->device() ? p->device()->devicePixelRatio() : 1.;
+        p->drawPixmap(rect, scaledPixmap(rect.size(), mode, state, dpr));
+    }
+
+    virtual QPixmap pixmap(const QSize &size, QIcon::Mode mode, QIcon::State state) override
+    { return scaledPixmap(size, mode, state, 1.); }
+
+    virtual QPixmap scaledPixmap(const QSize &size, QIcon::Mode mode, QIcon::State, qreal scale) override
+    {
+        auto pm = pixmapFromUrl(xdg_icon_lookup_scheme + name_, size, scale);
+        if (mode != QIcon::Normal && !pm.isNull())
+        {
+            QStyleOption opt;
+            opt.palette = QApplication::palette();
+            pm = qApp->style()->generatedIconPixmap(mode, pm, &opt);
+        }
+        return pm;
+    }
+
+    virtual QString iconName() override { return name_; }
+
+    virtual QIconEngine *clone() const override
+    { return new XdgIconEngine(*this); }
+
+};
+#endif
+
+static QPixmap renderPixmap(const QString &url, const QSize &requestedSize)
+{
+    TraceSpan span("renderPixmap", url);
+
+    // Decode the same way as the asynchronous pixmap loader, which shares the cache
+    if (auto image = imageFromUrl(url, requestedSize); image)
+        return QPixmap::fromImage(::move(*image));
 
     else if (url.startsWith(qfileiconprovider_scheme))
         return fileIcon(url.mid(qfileiconprovider_scheme.size())).pixmap(requestedSize, 1.);
 
-    else if (url.startsWith(xdg_icon_lookup_scheme))
+    else if (url.startsWith(xdg_icon_lookup_scheme))  // xdg lookup miss
 #if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
-        // return pixmapFromFilePath(xdgIconLookup(url.mid(xdg_icon_lookup_scheme.size())), requestedSize);
         return QIcon::fromTheme(url.mid(xdg_icon_lookup_scheme.size())).pixmap(requestedSize, 1.);
 #else
         return {};
@@ -167,9 +259,6 @@ QPixmap util::pixmapFromUrl(const QString &url, const QSize &requestedSize)
         return pm;
     }
 
-    else if (url.startsWith(file_scheme))
-        return pixmapFromFilePath(url.mid(file_scheme.size()), requestedSize);
-
     else if (url.startsWith(generative_scheme))
     {
         QUrlQuery urlquery(url.mid(generative_scheme.size()));
@@ -288,8 +377,27 @@ QPixmap util::pixmapFromUrl(const QString &url, const QSize &requestedSize)
         return pm;
     }
 
-    // Implicitly check for file existence
-    return pixmapFromFilePath(url, requestedSize);
+    return {};
+}
+
+QPixmap util::pixmapFromUrl(const QString &url, const QSize &requestedSize)
+{
+    TraceSpan span("pixmapFromUrl", url);
+    return PixmapCache::instance().get({url, requestedSize, 1.},
+                                       [&]{ return renderPixmap(url, requestedSize); });
+}
+
+QPixmap util::pixmapFromUrl(const QString &url, const QSize &requestedSize, qreal devicePixelRatio)
+{
+    if (devicePixelRatio == 1.)
+        return pixmapFromUrl(url, requestedSize);
+
+    TraceSpan span("pixmapFromUrl", url);
+    return PixmapCache::instance().get({url, requestedSize, devicePixelRatio}, [&]{
+        auto pm = renderPixmap(url, requestedSize * devicePixelRatio);
+        pm.setDevicePixelRatio(devicePixelRatio);
+        return pm;
+    });
 }
 
 QPixmap util::pixmapFromUrls(const QStringList &urls, const QSize &requestedSize)
@@ -302,6 +410,8 @@ QPixmap util::pixmapFromUrls(const QStringList &urls, const QSize &requestedSize
 
 QIcon util::iconFromUrl(const QString &url)
 {
+    TraceSpan span("iconFromUrl", url);
+
     if (url.startsWith(implicit_qrc_scheme))
         return QIcon(url); // intended, colon has to remain
 
@@ -312,12 +422,17 @@ QIcon util::iconFromUrl(const QString &url)
         return fileIcon(url.mid(qfileiconprovider_scheme.size()));
 
     else if (url.startsWith(xdg_icon_lookup_scheme))
+    {
 #if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
-        // return QIcon(xdgIconLookup(url.mid(xdg_icon_lookup_scheme.size())));
-        return QIcon::fromTheme(url.mid(xdg_icon_lookup_scheme.size()));
+        // Resolve the file per size when rendering. Leave misses to the Qt theme lookup.
+        const auto name = url.mid(xdg_icon_lookup_scheme.size());
+        if (!xdgIconLookup(name).isNull())
+            return QIcon(new XdgIconEngine(name));
+        return QIcon::fromTheme(name);
 #else
         return {};
 #endif
+    }
 
     else if (url.startsWith(qstandardpixmap_scheme))
         return standardIconFromName(url.mid(qstandardpixmap_scheme.size()));
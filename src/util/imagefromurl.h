@@ -0,0 +1,24 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#pragma once
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <optional>
+
+namespace albert::util
+{
+
+///
+/// Decodes the image of an icon URL, if this can be done off the GUI thread. Thread-safe.
+///
+/// Image files are downscaled while decoding if they are larger than `requestedSize`. Vector
+/// graphics are rendered at `requestedSize`. Used by the synchronous and the asynchronous pixmap
+/// rendering, which share the pixmap cache.
+///
+/// \returns The image, a null image if the URL yields none, nullopt if the URL has to be
+///          resolved in the GUI thread.
+///
+std::optional<QImage> imageFromUrl(const QString &url, const QSize &requestedSize);
+
+}
@@ -28,6 +28,20 @@ void IndexQueryHandler::setIndexItems(vector<IndexItem> &&index_items)
     d->index->setItems(::move(index_items));
 }
 
+IndexBuilder IndexQueryHandler::indexBuilder()
+{
+    // Pointer check not necessary since never called before setFuzzyMatching
+    shared_lock l(d->index_mutex);
+    return ItemIndex::builder(d->index->config(), [this](ItemIndex &&index)
+    {
+        unique_lock l(d->index_mutex);
+
+        // Drop indexes built using an outdated config, a rebuild is pending then
+        if (index.config().fuzzy == d->index->config().fuzzy)
+            *d->index = ::move(index);
+    });
+}
+
 vector<RankItem> IndexQueryHandler::handleGlobalQuery(const Query &query)
 {
     // Pointer check not necessary since never called before setFuzzyMatching
@@ -37,11 +51,14 @@ vector<RankItem> IndexQueryHandler::handleGlobalQuery(const Query &query)
 
 bool IndexQueryHandler::supportsFuzzyMatching() const { return true; }
 
+MatchConfig IndexQueryHandler::matchConfig() const { return {}; }
+
 void IndexQueryHandler::setFuzzyMatching(bool fuzzy)
 {
     if (!d->index)
     {
-        auto c = MatchConfig{.fuzzy = fuzzy};
+        auto c = matchConfig();
+        c.fuzzy = fuzzy;
         d->index = make_unique<ItemIndex>(c);
         updateIndexItems();
     }
@@ -5,113 +5,315 @@
 #include "logging.h"
 #include <QDir>
 #include <QFile>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
-#include <QStringList>
-#include <ranges>
+#include <QSaveFile>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <vector>
 using namespace albert::util;
 using namespace albert;
 using namespace std;
 
+static const uint default_limit = 10000;
+static const qsizetype min_compaction_garbage = 1000;
+
+// The history file is a journal. Each line is a JSON string literal of an entry, oldest first.
+// Adding an entry appends a line. Re-added entries supersede their previous occurrences. The
+// journal is compacted, i.e. rewritten containing the live entries only, once it contains more
+// superseded or dropped lines than live entries. Legacy history files (JSON array) are migrated.
+
+static QByteArray toJournalLine(const QString &text)
+{
+    auto line = QJsonDocument(QJsonArray{text}).toJson(QJsonDocument::Compact);  // ["…"]
+    line.back() = '\n';
+    return line.sliced(1);
+}
+
+static optional<QString> fromJournalLine(const QByteArray &line)
+{
+    if (line.size() < 2 || !line.startsWith('"') || !line.endsWith('"'))
+        return nullopt;  // e.g. truncated by a crash
+
+    if (!line.contains('\\'))  // fast path, nothing escaped
+        return QString::fromUtf8(line.sliced(1, line.size() - 2));
+
+    const auto doc = QJsonDocument::fromJson(QByteArray("[").append(line).append(']'));
+    if (!doc.isArray())
+        return nullopt;
+    return doc.array().at(0).toString();
+}
+
+// Three case folded UTF-16 code units packed into an integer
+static void forEachTrigram(const QString &text, const auto &callback)
+{
+    const auto folded = text.toCaseFolded();
+    for (qsizetype i = 0; i + 2 < folded.size(); ++i)
+        callback((quint64)folded[i].unicode() << 32
+                 | (quint64)folded[i+1].unicode() << 16
+                 | (quint64)folded[i+2].unicode());
+}
+
+
 class InputHistory::Private
 {
 public:
+
+    struct Entry
+    {
+        QString text;
+        bool live;
+    };
+
     QString file_path;
-    QStringList history;
-    qsizetype current;
-    uint max = -1;  // -1: max unsigned int
-};
+    QFile journal;
+    qsizetype journal_lines = 0;
 
+    vector<Entry> entries;                      // oldest first
+    QHash<QString, quint32> positions;          // text -> position of the live entry
+    QHash<quint64, vector<quint32>> trigrams;   // trigram -> positions, ascending
+    qsizetype live = 0;
+    qsizetype first_live = 0;                   // no live entries before
 
-InputHistory::InputHistory(const QString &path):
-    d(make_unique<Private>())
-{
-    if (path.isEmpty())
-        d->file_path = QDir(albert::dataLocation()).filePath("albert.history");
-    else
-        d->file_path = path;
+    qsizetype cursor;                           // entries.size(): reset
+    uint max = default_limit;
+
+    bool matches(qsizetype pos, const QString &pattern) const
+    {
+        const auto &e = entries[pos];
+        return e.live
+               && e.text != pattern  // skip if equals search string
+               && e.text.contains(pattern, Qt::CaseInsensitive);
+    }
 
-    if (QFile f(d->file_path); f.open(QIODevice::ReadOnly))
+    /// The postings of the rarest trigram of `pattern`. Nullptr if the pattern is too short.
+    /// Empty if some trigram does not occur, i.e. nothing matches.
+    const vector<quint32> *candidates(const QString &pattern) const
     {
-        const auto doc = QJsonDocument::fromJson(f.readAll());
+        static const vector<quint32> none;
+        const vector<quint32> *rarest = nullptr;
+        forEachTrigram(pattern, [&](quint64 trigram){
+            if (auto it = trigrams.constFind(trigram); it == trigrams.constEnd())
+                rarest = &none;
+            else if (!rarest || it->size() < rarest->size())
+                rarest = &it.value();
+        });
+        return rarest;
+    }
 
-        if (doc.isArray())
+    /// The position of the newest match older than `pos`.
+    optional<qsizetype> findOlder(qsizetype pos, const QString &pattern) const
+    {
+        if (auto *c = candidates(pattern))
         {
-            const auto a = doc.array();
-            d->history.reserve(a.size());
-            for (const auto v : a | views::reverse)
-                d->history << v.toString();
+            for (auto it = lower_bound(c->begin(), c->end(), pos); it != c->begin();)
+                if (--it; matches(*it, pattern))
+                    return *it;
         }
-        f.close();
+        else
+            for (auto p = pos - 1; p >= first_live; --p)
+                if (matches(p, pattern))
+                    return p;
+        return nullopt;
     }
 
-    resetIterator();
-}
+    /// The position of the oldest match newer than `pos`.
+    optional<qsizetype> findNewer(qsizetype pos, const QString &pattern) const
+    {
+        if (auto *c = candidates(pattern))
+        {
+            for (auto it = upper_bound(c->begin(), c->end(), pos); it != c->end(); ++it)
+                if (matches(*it, pattern))
+                    return *it;
+        }
+        else
+            for (auto p = pos + 1; p < (qsizetype)entries.size(); ++p)
+                if (matches(p, pattern))
+                    return p;
+        return nullopt;
+    }
 
-InputHistory::~InputHistory()
-{
-    if (QFile f(d->file_path); f.open(QIODevice::WriteOnly))
+    void insert(const QString &text)
     {
-        QJsonArray array;
-        for (const auto& line : d->history | views::reverse)
-            array.append(line);
+        if (auto it = positions.find(text); it != positions.end())
+        {
+            entries[it.value()].live = false;
+            --live;
+        }
 
-        const QJsonDocument doc(array);
-        f.write(doc.toJson(QJsonDocument::Indented));
+        const auto pos = (quint32)entries.size();
+        entries.push_back({text, true});
+        positions[text] = pos;
+        ++live;
+
+        forEachTrigram(text, [&](quint64 trigram){
+            if (auto &postings = trigrams[trigram]; postings.empty() || postings.back() != pos)
+                postings.push_back(pos);
+        });
+
+        trim();
+    }
+
+    // Drops the oldest entries exceeding the limit
+    void trim()
+    {
+        for (; live > (qsizetype)max; ++first_live)
+            if (auto &e = entries[first_live]; e.live)
+            {
+                e.live = false;
+                positions.remove(e.text);
+                --live;
+            }
+        while (first_live < (qsizetype)entries.size() && !entries[first_live].live)
+            ++first_live;
+    }
+
+    // Rebuilds the index and rewrites the journal containing the live entries only
+    void compact()
+    {
+        vector<Entry> old;
+        old.swap(entries);
+        positions.clear();
+        trigrams.clear();
+        live = 0;
+        first_live = 0;
+        for (auto &e : old)
+            if (e.live)
+                insert(e.text);
+
+        journal.close();
+        QSaveFile file(file_path);
+        if (file.open(QIODevice::WriteOnly))
+        {
+            for (const auto &e : entries)
+                file.write(toJournalLine(e.text));
+            if (!file.commit())
+                WARN << "Writing history file failed:" << file_path << file.errorString();
+        }
+        else
+            WARN << "Opening history file failed:" << file_path << file.errorString();
+
+        journal_lines = live;
+        openJournal();
+    }
+
+    void maybeCompact()
+    {
+        if (const auto garbage = journal_lines - live;
+            garbage > qMax(live, min_compaction_garbage))
+            compact();
+    }
+
+    void openJournal()
+    {
+        journal.setFileName(file_path);
+        if (!journal.open(QIODevice::WriteOnly | QIODevice::Append))
+            WARN << "Opening history file failed:" << file_path << journal.errorString();
+    }
+
+    void append(const QString &text)
+    {
+        if (journal.isOpen())
+        {
+            journal.write(toJournalLine(text));
+            journal.flush();  // survive crashes
+            ++journal_lines;
+        }
+    }
+
+    void load()
+    {
+        QFile f(file_path);
+        if (!f.open(QIODevice::ReadOnly))
+            return;
+
+        const auto bytes = f.readAll();
         f.close();
+
+        if (bytes.startsWith('['))  // legacy format, JSON array, oldest first
+        {
+            for (const auto v : QJsonDocument::fromJson(bytes).array())
+                if (const auto s = v.toString(); !s.isEmpty())
+                    insert(s);
+            journal_lines = numeric_limits<qsizetype>::max();  // migrate
+            return;
+        }
+
+        for (const auto &line : bytes.split('\n'))
+            if (const auto text = fromJournalLine(line); text && !text->isEmpty())
+            {
+                insert(*text);
+                ++journal_lines;
+            }
+            else if (!line.isEmpty())
+            {
+                WARN << "Skipping invalid history line:" << line;
+                ++journal_lines;
+            }
     }
+};
+
+
+InputHistory::InputHistory(const QString &path):
+    d(make_unique<Private>())
+{
+    if (path.isEmpty())
+        d->file_path = QDir(albert::dataLocation()).filePath("albert.history");
     else
-        WARN << "Writing history file failed:" << d->file_path;
+        d->file_path = path;
+
+    d->load();
+    d->maybeCompact();
+    if (!d->journal.isOpen())
+        d->openJournal();
+
+    resetIterator();
 }
 
+InputHistory::~InputHistory() = default;
+
 void InputHistory::add(const QString& s)
 {
-    if (!s.isEmpty())
+    if (!s.isEmpty() && d->max > 0)
     {
-        d->history.prepend(s);
-        d->history.removeDuplicates();
-        if (d->history.size() > d->max)
-            d->history.resize(d->max);
+        d->insert(s);
+        d->append(s);
+        d->maybeCompact();
     }
     resetIterator();
 }
 
 QString InputHistory::next(const QString &substring)
 {
-    while(true)
+    if (auto pos = d->findOlder(d->cursor, substring); pos)
     {
-        if (d->current == d->history.size() - 1)  // at end
-            return {};
-
-        if (const auto current_string = d->history.at(++d->current);
-            current_string != substring  // skip if equals search string
-            && current_string.contains(substring, Qt::CaseInsensitive))  // skip if no match
-            return current_string;
+        d->cursor = *pos;
+        return d->entries[*pos].text;
     }
+    else if (d->live > 0)  // stay at the end
+        d->cursor = d->first_live;
+    return {};
 }
 
 QString InputHistory::prev(const QString &substring)
 {
-    while(true)
+    if (auto pos = d->findNewer(d->cursor, substring); pos)
     {
-        if (d->current == 0)  // prev on first item: reset.
-            d->current = -1;
-
-        if (d->current == -1)  // at end
-            return {};
-
-        if (const auto current_string = d->history.at(--d->current);  // has been decremented above
-            current_string != substring  // skip if equals search string
-            && current_string.contains(substring, Qt::CaseInsensitive))  // skip if no match
-            return current_string;
+        d->cursor = *pos;
+        return d->entries[*pos].text;
     }
+    resetIterator();
+    return {};
 }
 
-void InputHistory::resetIterator() { d->current = -1; }
+void InputHistory::resetIterator() { d->cursor = (qsizetype)d->entries.size(); }
 
 void InputHistory::clear()
 {
-    d->history.clear();
+    d->entries.clear();
+    d->compact();
     resetIterator();
 }
 
@@ -122,8 +324,10 @@ void InputHistory::setLimit(uint v)
     if (v != d->max)
     {
         d->max = v;
-
-        if (d->history.size() > d->max)
-            d->history.resize(d->max);
+        const auto live = d->live;
+        d->trim();
+        if (d->live < live)
+            d->compact();  // the limit is not persisted, drop the entries from the journal
+        resetIterator();
     }
 }
@@ -5,11 +5,15 @@
 #include "levenshtein.h"
 #include "logging.h"
 #include <QRegularExpression>
+#include <QThread>
+#include <QtConcurrentMap>
 #include <algorithm>
+#include <limits>
 #include <map>
 #include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 using namespace albert;
 using namespace std;
@@ -21,6 +25,13 @@ namespace
 using Index = uint32_t;
 using Position = uint16_t;
 static const uint N = 2;
+static const Index max_gallop_words = 8;  // see searchMultiple
+static const size_t min_shard_size = 4096;  // items per build thread
+static const size_t search_shard_size = 32768;  // strings per index partition
+static const qsizetype min_infix_length = 2;
+static const qsizetype min_initials_length = 2;
+// Word match scores are at least 1 / max_match_len, i.e. greater than this weight
+static const double initials_score_weight = 1.0 / (numeric_limits<uint16_t>::max() + 1.0);
 
 
 struct StringIndexItem
@@ -41,7 +52,7 @@ struct WordIndexItem
 {
     QString word;
     vector<Location> occurrences;
-    // TODO: heres the place to add a term_frequency weighting approach
+    // Not weighted by term frequency, match scores are combined with usage scores downstream
 };
 
 
@@ -60,6 +71,34 @@ struct StringMatch
 };
 
 
+///
+/// A node of the word trie.
+///
+/// The words having the prefix spelled by the path to the node are the contiguous range
+/// [words_begin, words_end) of the sorted word index. If the first of them has the length of
+/// the prefix, the node is terminal for this word.
+///
+struct TrieNode
+{
+    QChar c;
+    Index children_begin;  // [ children
+    Index children_end;    // )
+    Index words_begin;     // [ words
+    Index words_end;       // )
+};
+
+
+///
+/// A distinct prefix of the words in the contiguous range [words_begin, words_end).
+///
+struct PrefixRange
+{
+    Index words_begin;
+    Index words_end;
+    uint16_t length;
+};
+
+
 struct IndexData
 {
     ///
@@ -91,8 +130,191 @@ struct IndexData
     /// The nGram index.
     ///
     unordered_map<QString, vector<Location>> ngrams;
+
+    ///
+    /// The word trie (built only for fuzzy automaton lookups).
+    ///
+    /// The root is the first node. The children of a node are contiguous and sorted.
+    ///
+    vector<TrieNode> trie;
+
+    ///
+    /// The deletion index (built only if typo_index_length is set).
+    ///
+    /// Maps the strings obtained by deleting characters from the word prefixes to the prefixes.
+    ///
+    /// deletion > [ p_idx ], p_idx > (w_idx range, prefix length)
+    ///
+    unordered_map<QString, vector<Index>> deletions;
+    vector<PrefixRange> prefixes;
+
+    ///
+    /// The suffix array of the word index (built only for infix matching).
+    ///
+    /// The proper suffixes of the words, at least min_infix_length long, sorted. Words longer
+    /// than the Position range have no suffixes.
+    ///
+    /// (w_idx, offset)
+    ///
+    vector<Location> suffixes;
+
+    ///
+    /// The initials index.
+    ///
+    /// The initials of the strings having at least min_initials_length, sorted.
+    ///
+    /// (initials, s_idx)
+    ///
+    vector<pair<QString, Index>> initials;
+
+    ///
+    /// The forward index (string index to words).
+    ///
+    /// The words of string s_idx are string_words[string_word_offsets[s_idx]…[s_idx+1]).
+    ///
+    /// s_idx > [ w_idx ]
+    ///
+    vector<Index> string_words;
+    vector<uint32_t> string_word_offsets;
+
+    ///
+    /// Prefix sums of the word occurrence counts.
+    ///
+    /// Used to estimate the amount of string matches of a word range.
+    ///
+    /// w_idx > Σ occurrences of words before w_idx
+    ///
+    vector<uint32_t> occurrence_offsets;
 };
 
+
+///
+/// A word of a multi-word query.
+///
+/// Matches the same words as getWordMatches, but tests index words on demand.
+///
+struct QueryWord
+{
+    QString word;
+    Index prefix_begin;  // [ perfect prefix match words
+    Index prefix_end;    // )
+    uint allowed_errors;
+    vector<QString> ngrams;
+    size_t estimated_cost;
+    unordered_map<Index, uint> fuzzy_match_lengths;  // memoized, 0: no match
+    bool fuzzy_match_lengths_complete = false;       // absent words do not match
+    unordered_map<Index, uint> infix_match_lengths;
+};
+
+
+///
+/// Returns the trie of the sorted `words`.
+///
+vector<TrieNode> buildTrie(const vector<WordIndexItem> &words)
+{
+    vector<TrieNode> trie;
+    trie.push_back({QChar(), 0, 0, 0, (Index)words.size()});
+
+    struct Pending
+    {
+        Index node;
+        int depth;
+    };
+
+    vector<Pending> pending{{0, 0}};
+    while (!pending.empty())
+    {
+        const auto [node, depth] = pending.back();
+        pending.pop_back();
+
+        auto begin = trie[node].words_begin;
+        const auto end = trie[node].words_end;
+
+        // Words are unique, the terminal word is the first one
+        if (begin < end && words[begin].word.length() == depth)
+            ++begin;
+
+        // Group the remaining words by the next character
+        trie[node].children_begin = trie.size();
+        while (begin < end)
+        {
+            const auto c = words[begin].word[depth];
+            auto group_end = begin + 1;
+            while (group_end < end && words[group_end].word[depth] == c)
+                ++group_end;
+            trie.push_back({c, 0, 0, begin, group_end});
+            begin = group_end;
+        }
+        trie[node].children_end = trie.size();
+
+        for (auto child = trie[node].children_begin; child < trie[node].children_end; ++child)
+            pending.push_back({child, depth + 1});
+    }
+
+    trie.shrink_to_fit();
+    return trie;
+}
+
+
+///
+/// A contiguous range [begin, end) of a build step processed by one thread.
+///
+struct Shard
+{
+    size_t index;
+    size_t begin;
+    size_t end;
+};
+
+
+///
+/// Returns `size` split into shards of at least `min_size`, at most one per core.
+///
+vector<Shard> makeShards(size_t size, size_t min_size = min_shard_size)
+{
+    const auto count = clamp<size_t>(size / min_size, 1, QThread::idealThreadCount());
+    vector<Shard> shards;
+    for (size_t s = 0; s < count; ++s)
+        shards.push_back({s, size * s / count, size * (s + 1) / count});
+    return shards;
+}
+
+
+///
+/// Runs `f` for all `shards`, in parallel if there are multiple.
+///
+template<class F>
+void forEachShard(vector<Shard> &shards, F f)
+{
+    if (shards.size() == 1)
+        f(shards.front());
+    else
+        QtConcurrent::blockingMap(shards, f);
+}
+
+
+///
+/// Returns the distinct strings obtained by deleting up to `deletions` characters from `string`
+/// that are not shorter than `min_length`, `string` included.
+///
+vector<QString> deletionVariants(const QString &string, uint deletions, qsizetype min_length)
+{
+    vector<QString> variants{string};
+    for (size_t level_begin = 0; deletions > 0; --deletions)
+    {
+        const auto level_end = variants.size();
+        for (auto v = level_begin; v < level_end; ++v)
+            for (qsizetype i = 0; i < variants[v].size() && variants[v].size() > min_length; ++i)
+                variants.emplace_back(QString(variants[v]).remove(i, 1));
+
+        // Deduplicate the new level
+        sort(variants.begin() + level_end, variants.end());
+        variants.erase(unique(variants.begin() + level_end, variants.end()), variants.end());
+        level_begin = level_end;
+    }
+    return variants;
+}
+
 }
 
 class ItemIndex::Private
@@ -102,13 +324,38 @@ public:
     mutable shared_mutex mutex;
     IndexData index;
 
-    QStringList tokenize(QString string) const;
+    ///
+    /// The index partitions. If not empty, the index data is empty and searches fan out to
+    /// these indexes. Each holds up to search_shard_size strings.
+    ///
+    vector<ItemIndex> shards;
+
+    QStringList tokenize(QString string, QString *initials = nullptr) const;
     vector<QString> ngrams_for_word(const QString &word)const;
+    pair<Index, Index> getPrefixRange(const QString &word) const;
+    vector<pair<Index, uint>> getAutomatonMatches(const QString &word, uint allowed_errors,
+                                                  const bool &isValid) const;
+    vector<pair<Index, uint>> getDeletionMatches(const QString &word, uint allowed_errors) const;
+    bool resolvesFuzzyMatches(uint word_length) const;
+    vector<pair<Index, uint>> resolveFuzzyMatches(const QString &word, uint allowed_errors,
+                                                  const bool &isValid) const;
+    void buildDeletionIndex(IndexData &index) const;
+    IndexData build(vector<IndexItem> &&index_items) const;
+    void buildWordLookups(IndexData &index) const;
+    vector<RankItem> searchShards(const QString &string, const bool &isValid) const;
+    void addInitialsMatches(const QString &word, unordered_map<Index, double> &result_map) const;
+    vector<pair<Index, uint>> getInfixMatches(const QString &word) const;
+    vector<WordMatch> getPrefixMatches(const QString &word, const bool &isValid) const;
     vector<WordMatch> getWordMatches(const QString &word, const bool &isValid) const;
     vector<StringMatch> getStringMatches(const QString &word, const bool &isValid) const;
+    QueryWord planQueryWord(const QString &word, const bool &isValid) const;
+    uint getFuzzyMatchLength(QueryWord &query_word, Index word_index,
+                             Levenshtein &levenshtein) const;
+    uint getMatchLength(QueryWord &query_word, Index word_index, Levenshtein &levenshtein) const;
+    vector<RankItem> searchMultiple(const QStringList &words, const bool &isValid) const;
 };
 
-QStringList ItemIndex::Private::tokenize(QString s) const
+QStringList ItemIndex::Private::tokenize(QString s, QString *initials) const
 {
     // Remove soft hyphens
     s.remove(QChar(0x00AD));
@@ -120,11 +367,24 @@ QStringList ItemIndex::Private::tokenize(QString s) const
         s = s.normalized(QString::NormalizationForm_D).remove(re);
     }
 
-    if (config.ignore_case)
-        s = s.toLower();
-
     auto t = s.split(config.separator_regex, Qt::SkipEmptyParts);
 
+    // The first letters of the words and camel humps, e.g. "vsc" for "Visual Studio Code" or
+    // "VisualStudioCode"
+    if (initials)
+        for (const auto &token : t)
+            for (qsizetype i = 0; i < token.size(); ++i)
+                if (i == 0 || (token[i].isUpper() && token[i-1].isLower()))
+                    *initials += token[i];
+
+    if (config.ignore_case)
+    {
+        for (auto &token : t)
+            token = token.toLower();
+        if (initials)
+            *initials = initials->toLower();
+    }
+
     if (config.ignore_word_order)
         t.sort();
 
@@ -144,29 +404,227 @@ vector<QString> ItemIndex::Private::ngrams_for_word(const QString &word) const
     return ngrams;
 }
 
-vector<WordMatch> ItemIndex::Private::getWordMatches(const QString &word, const bool &isValid) const
+pair<Index, Index> ItemIndex::Private::getPrefixRange(const QString &word) const
 {
-    vector<WordMatch> matches;
-    const uint word_length = word.length();
-
-    // Get range of perfect prefix match words
     const auto &[eq_begin, eq_end] =
             equal_range(
                 index.words.cbegin(), index.words.cend(), WordIndexItem{word, {}},
-                [l=word_length](const WordIndexItem &a, const WordIndexItem &b)
+                [l=word.length()](const WordIndexItem &a, const WordIndexItem &b)
                 { return QStringView{a.word}.left(l) < QStringView{b.word}.left(l); }
             );
+    return {eq_begin - index.words.cbegin(), eq_end - index.words.cbegin()};
+}
+
+vector<pair<Index, uint>>
+ItemIndex::Private::getAutomatonMatches(const QString &word, uint allowed_errors,
+                                        const bool &isValid) const
+{
+    // Simulates the Levenshtein automaton of the word by the rows of the edit distance matrix
+    // of the word and the prefix spelled by the current trie node. The prefix edit distance of
+    // an index word is the minimum of the last cells of the rows on its path. Since the row
+    // minimum never decreases, a row without cells <= allowed_errors prunes the subtree.
+
+    vector<pair<Index, uint>> matches;
+    if (index.trie.empty())
+        return matches;
+
+    const uint word_length = word.length();
+    const uint row_size = word_length + 1;
+
+    // The rows by depth, the path to the current node
+    vector<uint> rows(row_size);
+    for (uint i = 0; i < row_size; ++i)
+        rows[i] = i;
+
+    struct Pending
+    {
+        Index node;
+        uint depth;
+        uint distance;  // the minimum of the last cells on the path to the parent
+    };
+
+    vector<Pending> pending;
+    const auto &root = index.trie.front();
+    for (auto child = root.children_end; child-- > root.children_begin;)
+        pending.push_back({child, 1, word_length});
+
+    while (!pending.empty())
+    {
+        if (!isValid)
+            return {};
+
+        const auto [n, depth, parent_distance] = pending.back();
+        pending.pop_back();
+        const auto &node = index.trie[n];
+
+        if (rows.size() < (depth + 1) * row_size)
+            rows.resize((depth + 1) * row_size);
+        const uint *prev = &rows[(depth - 1) * row_size];
+        uint *row = &rows[depth * row_size];
+
+        row[0] = depth;
+        uint row_min = row[0];
+        for (uint i = 1; i < row_size; ++i)
+        {
+            row[i] = min({prev[i] + 1, row[i-1] + 1, prev[i-1] + (word[i-1] == node.c ? 0u : 1u)});
+            row_min = min(row_min, row[i]);
+        }
+
+        const auto distance = min(parent_distance, row[word_length]);
+
+        // Extensions can not improve the distance. Take the subtree as a whole.
+        if (distance == 0 || row_min > allowed_errors)
+        {
+            if (distance <= allowed_errors)
+                for (auto i = node.words_begin; i < node.words_end; ++i)
+                    matches.emplace_back(i, word_length - distance);
+            continue;
+        }
+
+        if (distance <= allowed_errors
+            && index.words[node.words_begin].word.length() == (qsizetype)depth)
+            matches.emplace_back(node.words_begin, word_length - distance);
+
+        for (auto child = node.children_end; child-- > node.children_begin;)
+            pending.push_back({child, depth + 1, distance});
+    }
+
+    return matches;
+}
+
+vector<pair<Index, uint>>
+ItemIndex::Private::getDeletionMatches(const QString &word, uint allowed_errors) const
+{
+    // If the edit distance of the word and a prefix is within allowed_errors, deleting up to
+    // allowed_errors characters from both yields a common string. The prefix edit distance of
+    // an index word is the minimum of the distances to its prefixes found this way.
+
+    const uint word_length = word.length();
+    unordered_map<Index, uint> distances;  // w_idx > distance
+    unordered_set<Index> probed;
+    Levenshtein levenshtein;
+
+    for (const auto &variant : deletionVariants(word, allowed_errors, 0))
+    {
+        const auto it = index.deletions.find(variant);
+        if (it == index.deletions.end())
+            continue;
+
+        for (const auto prefix_index : it->second)
+        {
+            if (!probed.insert(prefix_index).second)
+                continue;
+
+            const auto &prefix = index.prefixes[prefix_index];
+            const auto distance = levenshtein.computePrefixEditDistanceWithLimit(
+                word, index.words[prefix.words_begin].word.left(prefix.length), allowed_errors);
+            if (distance > allowed_errors)
+                continue;
+
+            for (auto i = prefix.words_begin; i < prefix.words_end; ++i)
+                if (const auto &[d, emplaced] = distances.emplace(i, distance);
+                    !emplaced && d->second > distance)
+                    d->second = distance;
+        }
+    }
+
+    vector<pair<Index, uint>> matches;
+    matches.reserve(distances.size());
+    for (const auto &[word_index, distance] : distances)
+        matches.emplace_back(word_index, word_length - distance);
+    ranges::sort(matches);
+    return matches;
+}
+
+bool ItemIndex::Private::resolvesFuzzyMatches(uint word_length) const
+{
+    return word_length <= config.typo_index_length
+           || config.fuzzy_lookup == MatchConfig::FuzzyLookup::Automaton;
+}
+
+vector<pair<Index, uint>>
+ItemIndex::Private::resolveFuzzyMatches(const QString &word, uint allowed_errors,
+                                        const bool &isValid) const
+{
+    if ((uint)word.length() <= config.typo_index_length)
+        return getDeletionMatches(word, allowed_errors);
+    else
+        return getAutomatonMatches(word, allowed_errors, isValid);
+}
+
+vector<pair<Index, uint>> ItemIndex::Private::getInfixMatches(const QString &word) const
+{
+    // Infix matches count half, such that they rank below prefix matches
+    vector<pair<Index, uint>> matches;
+    if (word.length() < min_infix_length)
+        return matches;
+
+    // The suffixes starting with the word, O(m log n)
+    const auto infix = [&](const Location &l)
+    { return QStringView(index.words[l.index].word).mid(l.position).left(word.length()); };
+
+    const auto begin = lower_bound(index.suffixes.cbegin(), index.suffixes.cend(), word,
+                                   [&](const Location &l, const QString &w){ return infix(l) < w; });
+    const auto end = upper_bound(begin, index.suffixes.cend(), word,
+                                 [&](const QString &w, const Location &l){ return w < infix(l); });
+
+    for (auto it = begin; it != end; ++it)
+        matches.emplace_back(it->index, word.length() / 2);
+
+    // A word may contain the infix multiple times
+    ranges::sort(matches);
+    matches.erase(unique(matches.begin(), matches.end()), matches.end());
+    return matches;
+}
+
+vector<WordMatch> ItemIndex::Private::getWordMatches(const QString &word, const bool &isValid) const
+{
+    auto matches = getPrefixMatches(word, isValid);
+    if (!config.infix || !isValid)
+        return matches;
+
+    unordered_map<Index, size_t> matched;  // w_idx > match index
+    for (size_t i = 0; i < matches.size(); ++i)
+        matched.emplace(&matches[i].word_index_item - index.words.data(), i);
+
+    for (const auto &[word_index, match_length] : getInfixMatches(word))
+        if (const auto it = matched.find(word_index); it == matched.end())
+            matches.emplace_back(index.words[word_index], match_length);
+        else if (auto &m = matches[it->second]; m.match_length < match_length)
+            m.match_length = match_length;
+
+    return matches;
+}
+
+vector<WordMatch> ItemIndex::Private::getPrefixMatches(const QString &word, const bool &isValid) const
+{
+    vector<WordMatch> matches;
+    const uint word_length = word.length();
+
+    // Get range of perfect prefix match words
+    const auto [exclude_begin, exclude_end] = getPrefixRange(word);
 
     // Store perfect prefix match words
-    for (auto it = eq_begin; it != eq_end; ++it)
-        matches.emplace_back(*it, word_length);
+    for (auto i = exclude_begin; i != exclude_end; ++i)
+        matches.emplace_back(index.words[i], word_length);
 
-    // Get the (fuzzy) prefix matches
-    if (config.fuzzy)
+    // Get the (fuzzy) prefix matches. Without allowed errors these are the prefix matches.
+    if (config.fuzzy && word_length / config.error_tolerance_divisor > 0)
     {
-        // Exclusion range for already collected prefix matches
-        Index exclude_begin = eq_begin - index.words.begin();  // Ignore interval. closed begin [
-        Index exclude_end = eq_end - index.words.begin();  // Ignore interval. open end )
+        if (resolvesFuzzyMatches(word_length))
+        {
+            // These lookups yield the perfect prefix matches too
+            for (const auto &[word_idx, match_length] :
+                 resolveFuzzyMatches(word, word_length / config.error_tolerance_divisor, isValid))
+                if (match_length < word_length)
+                    matches.emplace_back(index.words[word_idx], match_length);
+
+            if (!isValid)
+                return {};
+            return matches;
+        }
+
+        // Exclusion range for already collected prefix matches: [exclude_begin, exclude_end)
 
         auto ngrams = ngrams_for_word(word);
 
@@ -229,18 +687,263 @@ vector<WordMatch> ItemIndex::Private::getWordMatches(const QString &word, const
 vector<StringMatch>
 ItemIndex::Private::getStringMatches(const QString &word, const bool &isValid) const
 {
-    vector<StringMatch> string_matches;
+    // The occurrences of every word are sorted by string index. K-way merge them.
+
+    struct Cursor
+    {
+        vector<Location>::const_iterator it;
+        vector<Location>::const_iterator end;
+        uint16_t match_len;
+    };
 
+    vector<Cursor> heap;
+    size_t total = 0;
     for (const auto &word_match : getWordMatches(word, isValid))
-        for (const auto &occurrence : word_match.word_index_item.occurrences)
-            string_matches.emplace_back(occurrence.index, occurrence.position, word_match.match_length);
+        if (const auto &o = word_match.word_index_item.occurrences; !o.empty())
+        {
+            heap.emplace_back(o.cbegin(), o.cend(), word_match.match_length);
+            total += o.size();
+        }
+
+    vector<StringMatch> string_matches;
+    string_matches.reserve(total);
 
-    sort(string_matches.begin(), string_matches.end(),
-         [](auto &l, auto &r){ return l.index < r.index; });
+    const auto greater = [](const Cursor &l, const Cursor &r){ return l.it->index > r.it->index; };
+    ranges::make_heap(heap, greater);
+    while (!heap.empty())
+    {
+        ranges::pop_heap(heap, greater);
+        auto &c = heap.back();
+
+        // Take the run of the cursor preceding the next smallest index
+        const auto bound = heap.size() == 1 ? numeric_limits<Index>::max() : heap.front().it->index;
+        for (; c.it != c.end && c.it->index <= bound; ++c.it)
+            string_matches.emplace_back(c.it->index, c.it->position, c.match_len);
+
+        if (c.it == c.end)
+            heap.pop_back();
+        else
+            ranges::push_heap(heap, greater);
+    }
 
     return string_matches;
 }
 
+/// Returns the first location in [begin, end) with an index not less than `index`.
+/// Exponential search, i.e. logarithmic in the distance to the result.
+static vector<Location>::const_iterator gallop(vector<Location>::const_iterator begin,
+                                               vector<Location>::const_iterator end,
+                                               Index index)
+{
+    const auto less = [](const Location &l, Index i){ return l.index < i; };
+    for (ptrdiff_t step = 1; begin != end && begin->index < index; step *= 2)
+    {
+        const auto next = end - begin > step ? begin + step : end;
+        if (next == end || next->index >= index)
+            return lower_bound(begin, next, index, less);
+        begin = next;
+    }
+    return begin;
+}
+
+QueryWord ItemIndex::Private::planQueryWord(const QString &word, const bool &isValid) const
+{
+    QueryWord w{.word = word};
+    tie(w.prefix_begin, w.prefix_end) = getPrefixRange(word);
+
+    // The string matches of the prefix range are known exactly
+    w.estimated_cost = index.occurrence_offsets[w.prefix_end]
+                       - index.occurrence_offsets[w.prefix_begin];
+
+    w.allowed_errors = config.fuzzy ? word.length() / config.error_tolerance_divisor : 0;
+    if (w.allowed_errors > 0 && resolvesFuzzyMatches(word.length()))
+    {
+        // Cheap enough to resolve the fuzzy matches up front
+        for (const auto &[word_index, match_length] :
+             resolveFuzzyMatches(word, w.allowed_errors, isValid))
+            if (match_length < (uint)word.length())
+            {
+                w.fuzzy_match_lengths.emplace(word_index, match_length);
+                w.estimated_cost += index.words[word_index].occurrences.size();
+            }
+        w.fuzzy_match_lengths_complete = true;
+    }
+    else if (w.allowed_errors > 0)
+    {
+        // Fuzzy lookups scan the occurrences of all nGrams of the word
+        w.ngrams = ngrams_for_word(word);
+        for (const auto &ngram : w.ngrams)
+            if (auto it = index.ngrams.find(ngram); it != index.ngrams.end())
+                w.estimated_cost += it->second.size();
+    }
+
+    if (config.infix)
+        for (const auto &[word_index, match_length] : getInfixMatches(word))
+            if (word_index < w.prefix_begin || w.prefix_end <= word_index)
+            {
+                w.infix_match_lengths.emplace(word_index, match_length);
+                w.estimated_cost += index.words[word_index].occurrences.size();
+            }
+
+    return w;
+}
+
+uint ItemIndex::Private::getMatchLength(QueryWord &w, Index word_index,
+                                        Levenshtein &levenshtein) const
+{
+    if (w.prefix_begin <= word_index && word_index < w.prefix_end)
+        return w.word.length();
+
+    uint infix_match_length = 0;
+    if (auto it = w.infix_match_lengths.find(word_index); it != w.infix_match_lengths.end())
+        infix_match_length = it->second;
+
+    return max(infix_match_length, getFuzzyMatchLength(w, word_index, levenshtein));
+}
+
+uint ItemIndex::Private::getFuzzyMatchLength(QueryWord &w, Index word_index,
+                                             Levenshtein &levenshtein) const
+{
+    const uint word_length = w.word.length();
+
+    if (w.allowed_errors == 0)
+        return 0;
+
+    if (auto it = w.fuzzy_match_lengths.find(word_index); it != w.fuzzy_match_lengths.end())
+        return it->second;
+    else if (w.fuzzy_match_lengths_complete)
+        return 0;
+
+    // Same preselection as in getWordMatches: Count the nGrams of the query word occurring in
+    // the index word at a position < word_length.
+    const auto &other = index.words[word_index].word;
+    const auto other_ngrams = ngrams_for_word(other);
+    const auto positions = min<size_t>(other_ngrams.size(), word_length);
+    uint ngram_count = 0;
+    for (const auto &ngram : w.ngrams)
+        for (size_t p = 0; p < positions; ++p)
+            if (other_ngrams[p] == ngram)
+                ++ngram_count;
+
+    uint match_length = 0;
+    if (ngram_count >= word_length - w.allowed_errors * N)
+        if (auto edit_distance =
+                levenshtein.computePrefixEditDistanceWithLimit(w.word, other, w.allowed_errors);
+            edit_distance <= w.allowed_errors)
+            match_length = word_length - edit_distance;
+
+    w.fuzzy_match_lengths.emplace(word_index, match_length);
+    return match_length;
+}
+
+vector<RankItem> ItemIndex::Private::searchMultiple(const QStringList &words,
+                                                    const bool &isValid) const
+{
+    // Query planning: Expand only the most selective word into string matches and probe the
+    // other words on the words of the matched strings using the forward index. This way the
+    // cost is dominated by the rarest word, not by the most common one.
+
+    vector<QueryWord> query_words;
+    query_words.reserve(words.size());
+    for (const auto &word : words)
+        query_words.emplace_back(planQueryWord(word, isValid));
+
+    const auto &driver = *ranges::min_element(query_words, {}, &QueryWord::estimated_cost);
+    const auto candidates = getStringMatches(driver.word, isValid);  // sorted by string index
+
+    // Exact words matching a few index words only are checked first by galloping through the
+    // postings of these words, which is cheaper than probing the words of the string.
+    struct PostingCursor
+    {
+        vector<Location>::const_iterator it;
+        vector<Location>::const_iterator end;
+    };
+    vector<vector<PostingCursor>> filters;
+    for (const auto &w : query_words)
+        if (&w != &driver && w.allowed_errors == 0 && w.infix_match_lengths.empty()
+            && w.prefix_end - w.prefix_begin <= max_gallop_words)
+        {
+            if (w.prefix_begin == w.prefix_end)
+                return {};  // no match at all
+
+            auto &filter = filters.emplace_back();
+            for (auto i = w.prefix_begin; i < w.prefix_end; ++i)
+                filter.emplace_back(index.words[i].occurrences.cbegin(),
+                                    index.words[i].occurrences.cend());
+        }
+
+    // Candidates are ascending, so are the cursors
+    const auto passesFilters = [&filters](Index string_index)
+    {
+        return ranges::all_of(filters, [=](auto &filter){
+            return ranges::any_of(filter, [=](PostingCursor &c){
+                c.it = gallop(c.it, c.end, string_index);
+                return c.it != c.end && c.it->index == string_index;
+            });
+        });
+    };
+
+    Levenshtein levenshtein;
+    unordered_map<Index, double> result_map;
+    vector<int> chain, next_chain;
+
+    for (auto it = candidates.cbegin(); it != candidates.cend();)
+    {
+        if (!isValid)
+            return {};
+
+        const auto string_index = it->index;
+        while (it != candidates.cend() && it->index == string_index)
+            ++it;
+
+        if (!passesFilters(string_index))
+            continue;
+
+        const auto words_begin = index.string_word_offsets[string_index];
+        const auto word_count = index.string_word_offsets[string_index + 1] - words_begin;
+
+        // chain[p]: The highest match length sum of the query words so far, the last one
+        // matching the word at position p (sequence check). -1 if there is no such chain.
+        chain.assign(word_count, 0);
+        for (size_t q = 0; q < query_words.size(); ++q)
+        {
+            next_chain.assign(word_count, -1);
+            int preceding = q == 0 ? 0 : -1;  // the best chain ending before p
+            for (uint32_t p = 0; p < word_count; ++p)
+            {
+                if (const auto ml = getMatchLength(query_words[q],
+                                                   index.string_words[words_begin + p],
+                                                   levenshtein);
+                    ml > 0 && preceding >= 0)
+                    next_chain[p] = preceding + (int)ml;
+
+                if (q > 0)
+                    preceding = max(preceding, chain[p]);
+            }
+            swap(chain, next_chain);
+        }
+
+        const auto match_len = ranges::max(chain);
+        if (match_len < 0)
+            continue;
+
+        const auto &string_index_item = index.strings[string_index];
+        double score = (double)match_len / string_index_item.max_match_len;
+
+        const auto &[rit, success] = result_map.emplace(string_index_item.item_index, score);
+
+        // Update score if exists and is less
+        if (!success && rit->second < score)
+            rit->second = score;
+    }
+
+    vector<RankItem> result;
+    result.reserve(result_map.size());
+    for (const auto &[item_idx, score] : result_map)
+        result.emplace_back(index.items[item_idx], score);
+    return result;
+}
+
 
 ItemIndex::ItemIndex(MatchConfig config)
     : d(new Private{.config = ::move(config), .mutex = {}, .index = {}}) {}
@@ -253,16 +956,50 @@ ItemIndex::~ItemIndex() = default;
 
 const MatchConfig &ItemIndex::config() { return d->config; }
 
-void ItemIndex::setItems(vector<IndexItem> &&index_items)
+IndexData ItemIndex::Private::build(vector<IndexItem> &&index_items) const
 {
+    // The build is sharded by contiguous ranges, such that concatenating shard results in shard
+    // order yields the same order as a sequential build.
+
     IndexData new_index;
+    auto shards = makeShards(index_items.size());
 
-    unordered_map<albert::Item*,Index> item_indices_;  // implicit unique
-    map<QString,WordIndexItem> word_index_;  // implicit lexicographical order
+    // Tokenize and build the word maps of the shards. Strings are indexed relative to the
+    // shard since the amount of empty tokenizations of the preceding shards is unknown yet.
+
+    vector<QStringList> tokens(index_items.size());
+    vector<QString> initials(index_items.size());
+    vector<map<QString, vector<Location>>> word_maps(shards.size());  // lexicographical order
+    vector<Index> shard_string_offsets(shards.size() + 1, 0);
+
+    forEachShard(shards, [&](const Shard &shard)
+    {
+        auto &word_map = word_maps[shard.index];
+        Index string_index = 0;
+        for (auto i = shard.begin; i < shard.end; ++i)
+        {
+            auto &words = tokens[i] = tokenize(index_items[i].string,
+                                               config.initials ? &initials[i] : nullptr);
+            if (words.empty())
+                continue;
+
+            for (Position p = 0; p < (Position)words.size(); ++p)
+                word_map[words[p]].emplace_back(string_index, p);
+            ++string_index;
+        }
+        shard_string_offsets[shard.index + 1] = string_index;
+    });
 
-    for (auto &[item, string] : index_items)
+    for (size_t s = 0; s < shards.size(); ++s)
+        shard_string_offsets[s + 1] += shard_string_offsets[s];
+
+    // Build the item and string index sequentially, cheap compared to tokenization.
+
+    unordered_map<albert::Item*,Index> item_indices_;  // implicit unique
+    for (size_t i = 0; i < index_items.size(); ++i)
     {
-        QStringList &&words = d->tokenize(string);
+        auto &[item, string] = index_items[i];
+        const auto &words = tokens[i];
         if (words.empty())
         {
             WARN << QString("Skipping index entry '%1'. Tokenization of '%2' yields empty set.")
@@ -280,46 +1017,322 @@ void ItemIndex::setItems(vector<IndexItem> &&index_items)
 
         // Add string to item mapping.
         auto &string_index_item = new_index.strings.emplace_back(it->second, 0);
+        new_index.string_word_offsets.emplace_back(new_index.string_words.size());
+        new_index.string_words.resize(new_index.string_words.size() + words.size());
 
-        // Iterate the words
-        for (Position p = 0; p < (Position)words.size(); ++p)
-        {
-            // Add word to string mapping.
-            word_index_[words[p]].occurrences.emplace_back(new_index.strings.size() - 1, p);
+        // Store the maximal match length for scoring
+        for (const auto &word : words)
+            string_index_item.max_match_len += word.size();
 
-            // Store the maximal match length for scoring
-            string_index_item.max_match_len += words[p].size();
-        }
+        if (initials[i].size() >= min_initials_length)
+            new_index.initials.emplace_back(::move(initials[i]), new_index.strings.size() - 1);
     }
 
     new_index.items.shrink_to_fit();
     new_index.strings.shrink_to_fit();
+    new_index.string_word_offsets.emplace_back(new_index.string_words.size());
+    new_index.string_word_offsets.shrink_to_fit();
+    new_index.string_words.shrink_to_fit();
+    tokens = {};
+    initials = {};
 
-    // Build the random access word index
-    for (auto &[word, word_index_item] : word_index_)
+    // Merge the word maps into the sorted word index. The key space is partitioned by splitter
+    // words sampled from the largest map, then the partitions are k-way merged in parallel.
+
+    vector<QString> splitters;
+    if (shards.size() > 1)
     {
-        word_index_item.word = word;
-        word_index_item.word.shrink_to_fit();
-        word_index_item.occurrences.shrink_to_fit();
-        new_index.words.emplace_back(::move(word_index_item));
+        const auto &largest = *ranges::max_element(word_maps, {}, &map<QString, vector<Location>>::size);
+        const auto step = max<size_t>(1, largest.size() / shards.size());
+        size_t n = 0;
+        for (const auto &[word, _] : largest)
+            if (++n % step == 0 && splitters.size() + 1 < shards.size())
+                splitters.emplace_back(word);
+    }
+
+    auto partitions = makeShards(splitters.size() + 1, 1);
+    vector<vector<WordIndexItem>> partition_words(partitions.size());
+
+    forEachShard(partitions, [&](const Shard &partition)
+    {
+        using MapIterator = map<QString, vector<Location>>::iterator;
+        struct Cursor
+        {
+            MapIterator it;
+            MapIterator end;
+            size_t shard;
+        };
+
+        vector<Cursor> heap;
+        for (size_t s = 0; s < word_maps.size(); ++s)
+        {
+            auto &m = word_maps[s];
+            const auto begin = partition.index == 0 ? m.begin()
+                                                    : m.lower_bound(splitters[partition.index - 1]);
+            const auto end = partition.index == splitters.size() ? m.end()
+                                                                 : m.lower_bound(splitters[partition.index]);
+            if (begin != end)
+                heap.emplace_back(begin, end, s);
+        }
+
+        // Equal words are popped in shard order
+        const auto greater = [](const Cursor &l, const Cursor &r)
+        { return l.it->first != r.it->first ? l.it->first > r.it->first : l.shard > r.shard; };
+        ranges::make_heap(heap, greater);
+
+        auto &words = partition_words[partition.index];
+        while (!heap.empty())
+        {
+            ranges::pop_heap(heap, greater);
+            auto &c = heap.back();
+
+            auto &occurrences = c.it->second;
+            for (auto &occurrence : occurrences)
+                occurrence.index += shard_string_offsets[c.shard];
+
+            if (words.empty() || words.back().word != c.it->first)
+                words.emplace_back(c.it->first, ::move(occurrences));
+            else
+                words.back().occurrences.insert(words.back().occurrences.end(),
+                                                occurrences.begin(), occurrences.end());
+
+            if (++c.it == c.end)
+                heap.pop_back();
+            else
+                ranges::push_heap(heap, greater);
+        }
+
+        for (auto &word_index_item : words)
+        {
+            word_index_item.word.shrink_to_fit();
+            word_index_item.occurrences.shrink_to_fit();
+        }
+    });
+
+    word_maps = {};
+
+    size_t word_count = 0;
+    for (const auto &words : partition_words)
+        word_count += words.size();
+    new_index.words.reserve(word_count);
+    for (auto &words : partition_words)
+        ranges::move(words, back_inserter(new_index.words));
+    partition_words = {};
+
+    // Build the forward index
+
+    auto word_shards = makeShards(new_index.words.size());
+    forEachShard(word_shards, [&](const Shard &shard)
+    {
+        for (auto word_index = (Index)shard.begin; word_index < shard.end; ++word_index)
+            for (const auto &[string_index, position] : new_index.words[word_index].occurrences)
+                new_index.string_words[new_index.string_word_offsets[string_index] + position]
+                    = word_index;
+    });
+
+    buildWordLookups(new_index);
+    return new_index;
+}
+
+void ItemIndex::Private::buildWordLookups(IndexData &new_index) const
+{
+    ranges::sort(new_index.initials);
+    new_index.initials.shrink_to_fit();
+
+    new_index.occurrence_offsets.reserve(new_index.words.size() + 1);
+    new_index.occurrence_offsets.emplace_back(0);
+    for (const auto &word_index_item : new_index.words)
+        new_index.occurrence_offsets.emplace_back(new_index.occurrence_offsets.back()
+                                                  + word_index_item.occurrences.size());
+
+    if (config.fuzzy && config.fuzzy_lookup == MatchConfig::FuzzyLookup::Automaton)
+        new_index.trie = buildTrie(new_index.words);
+    else if (config.fuzzy)
+    {
+        // Build the nGram postings of the shards, concatenate them in shard order
+        auto word_shards = makeShards(new_index.words.size());
+        vector<unordered_map<QString, vector<Location>>> ngram_maps(word_shards.size());
+        forEachShard(word_shards, [&](const Shard &shard)
+        {
+            auto &ngram_map = ngram_maps[shard.index];
+            for (auto word_index = (Index)shard.begin; word_index < shard.end; ++word_index)
+            {
+                auto ngrams = ngrams_for_word(new_index.words[word_index].word);
+                for (Position pos = 0 ; pos < (Position)ngrams.size(); ++pos)
+                    ngram_map[ngrams[pos]].emplace_back(word_index, pos);
+            }
+        });
+
+        new_index.ngrams = ::move(ngram_maps.front());
+        for (size_t s = 1; s < ngram_maps.size(); ++s)
+            for (auto &[ngram, locations] : ngram_maps[s])
+            {
+                auto &l = new_index.ngrams[ngram];
+                l.insert(l.end(), locations.begin(), locations.end());
+            }
+
+        for (auto &[_, word_refs] : new_index.ngrams)
+            word_refs.shrink_to_fit();
+    }
+
+    if (config.fuzzy && config.typo_index_length >= MatchConfig::error_tolerance_divisor)
+        buildDeletionIndex(new_index);
+
+    if (config.infix)
+    {
+        // Build the suffix array. Offset 0 is covered by the word index. Words too long for
+        // the offsets to fit a Position are skipped, they match by prefix only.
+        const auto &words = new_index.words;
+        for (Index word_index = 0; word_index < (Index)words.size(); ++word_index)
+        {
+            const auto word_size = words[word_index].word.size();
+            if (word_size > numeric_limits<Position>::max())
+                continue;
+            for (qsizetype offset = 1; offset + min_infix_length <= word_size; ++offset)
+                new_index.suffixes.emplace_back(word_index, (Position)offset);
+        }
+
+        const auto suffix = [&](const Location &l)
+        { return QStringView(words[l.index].word).mid(l.position); };
+        ranges::sort(new_index.suffixes,
+                     [&](const Location &a, const Location &b){ return suffix(a) < suffix(b); });
+        new_index.suffixes.shrink_to_fit();
     }
-    new_index.words.shrink_to_fit();
+}
 
-    if (d->config.fuzzy)
+vector<RankItem> ItemIndex::Private::searchShards(const QString &string, const bool &isValid) const
+{
+    vector<vector<RankItem>> shard_results(shards.size());
+
+    auto tasks = makeShards(shards.size(), 1);
+    forEachShard(tasks, [&](const Shard &task)
     {
-        // Build n_gram_index
-        for (Index word_index = 0; word_index < (Index)new_index.words.size(); ++word_index)
+        for (auto s = task.begin; s < task.end && isValid; ++s)
+            shard_results[s] = shards[s].search(string, isValid);
+    });
+
+    if (!isValid)
+        return {};
+
+    // Items may have strings in several shards. Keep the highest score.
+    vector<RankItem> result;
+    unordered_map<albert::Item*, size_t> result_indices;
+    for (auto &results : shard_results)
+        for (auto &rank_item : results)
         {
-            auto ngrams = d->ngrams_for_word(new_index.words[word_index].word);
-            for (Position pos = 0 ; pos < (Position)ngrams.size(); ++pos)
-                new_index.ngrams[ngrams[pos]].emplace_back(word_index, pos);
+            const auto &[it, emplaced] = result_indices.emplace(rank_item.item.get(), result.size());
+            if (emplaced)
+                result.emplace_back(::move(rank_item));
+            else if (result[it->second].score < rank_item.score)
+                result[it->second].score = rank_item.score;
         }
+    return result;
+}
+
+void ItemIndex::Private::addInitialsMatches(const QString &word,
+                                            unordered_map<Index, double> &result_map) const
+{
+    if (!config.initials || word.size() < min_initials_length)
+        return;
+
+    // The initials starting with the word, O(log n)
+    const auto [begin, end] =
+        equal_range(index.initials.cbegin(), index.initials.cend(), pair{word, Index{}},
+                    [l=word.length()](const auto &a, const auto &b)
+                    { return QStringView{a.first}.left(l) < QStringView{b.first}.left(l); });
+
+    // Initials matches score the matched fraction of the initials, scaled below word matches
+    for (auto it = begin; it != end; ++it)
+    {
+        const double score = initials_score_weight * word.size() / it->first.size();
+        const auto &[rit, success] = result_map.emplace(index.strings[it->second].item_index, score);
+
+        // Update score if exists and is less
+        if (!success && rit->second < score)
+            rit->second = score;
+    }
+}
+
+void ItemIndex::setItems(vector<IndexItem> &&index_items)
+{
+    if (index_items.size() <= search_shard_size)
+    {
+        auto new_index = d->build(::move(index_items));
+
+        unique_lock lock(d->mutex);
+        d->index = ::move(new_index);
+        d->shards.clear();
+        return;
+    }
+
+    // Partition large indexes, such that searches scale with cores
+    vector<ItemIndex> shards;
+    for (size_t begin = 0; begin < index_items.size(); begin += search_shard_size)
+    {
+        const auto end = min(begin + search_shard_size, index_items.size());
+        auto &shard = shards.emplace_back(d->config);
+        shard.setItems(vector<IndexItem>(make_move_iterator(index_items.begin() + begin),
+                                         make_move_iterator(index_items.begin() + end)));
     }
-    for (auto &[_, word_refs] : new_index.ngrams)
-        word_refs.shrink_to_fit();
 
     unique_lock lock(d->mutex);
-    d->index = new_index;
+    d->index = {};
+    d->shards = ::move(shards);
+}
+
+void ItemIndex::Private::buildDeletionIndex(IndexData &new_index) const
+{
+    // Query words of length m match prefixes of length m ± m/divisor, the shortest common
+    // deletion of the shortest fuzzy query word (m = divisor) has length divisor - 1.
+    const uint max_errors = config.typo_index_length / config.error_tolerance_divisor;
+    const uint min_length = config.error_tolerance_divisor - 1;
+    const uint max_length = config.typo_index_length + max_errors;
+    const auto &words = new_index.words;
+
+    for (uint length = min_length; length <= max_length; ++length)
+    {
+        for (Index begin = 0; begin < (Index)words.size();)
+        {
+            if ((uint)words[begin].word.length() < length)
+            {
+                ++begin;
+                continue;
+            }
+
+            // The words having this prefix are contiguous
+            const auto prefix = QStringView(words[begin].word).left(length);
+            auto end = begin + 1;
+            while (end < (Index)words.size() && QStringView(words[end].word).left(length) == prefix)
+                ++end;
+
+            const Index prefix_index = new_index.prefixes.size();
+            new_index.prefixes.push_back({begin, end, (uint16_t)length});
+            for (auto &variant : deletionVariants(prefix.toString(), max_errors, min_length))
+                new_index.deletions[::move(variant)].emplace_back(prefix_index);
+
+            begin = end;
+        }
+    }
+
+    size_t postings = 0;
+    size_t key_chars = 0;
+    for (auto &[variant, prefix_indices] : new_index.deletions)
+    {
+        prefix_indices.shrink_to_fit();
+        postings += prefix_indices.size();
+        key_chars += variant.size();
+    }
+    new_index.prefixes.shrink_to_fit();
+
+    // Hash nodes are estimated as key, value and two pointers
+    const auto bytes = new_index.prefixes.size() * sizeof(PrefixRange)
+                       + postings * sizeof(Index)
+                       + key_chars * sizeof(QChar)
+                       + new_index.deletions.size() * (sizeof(QString) + sizeof(vector<Index>)
+                                                       + 2 * sizeof(void*));
+    DEBG << QString("Deletion index: %1 prefixes, %2 deletions, %3 postings, ~%4 KiB.")
+                .arg(new_index.prefixes.size()).arg(new_index.deletions.size())
+                .arg(postings).arg(bytes / 1024);
 }
 
 vector<albert::RankItem> ItemIndex::search(const QString &string, const bool &isValid) const
@@ -328,6 +1341,9 @@ vector<albert::RankItem> ItemIndex::search(const QString &string, const bool &is
     QStringList &&words = d->tokenize(string);
     shared_lock lock(d->mutex);
 
+    if (!d->shards.empty())
+        return d->searchShards(string, isValid);
+
     if (words.empty())
     {
         if (string.isEmpty())
@@ -339,52 +1355,13 @@ vector<albert::RankItem> ItemIndex::search(const QString &string, const bool &is
             return result;
         }
     }
+    else if (words.size() > 1)
+        return d->searchMultiple(words, isValid);
     else
     {
         unordered_map<Index, double> result_map;
         vector<StringMatch> string_matches = d->getStringMatches(words[0], isValid);
 
-        // In case of multiple words intersect. Todo: user chooses strategy
-        for (int w = 1; w < words.size(); ++w)
-        {
-            if (!isValid || string_matches.empty())
-                return {};
-
-            vector<StringMatch> other_string_matches = d->getStringMatches(words[w], isValid);
-
-            if (other_string_matches.empty())
-                return {};
-
-            vector<StringMatch> new_string_matches;
-            for (auto lit = string_matches.cbegin(); lit != string_matches.cend();)
-            {
-                // Build a range of upcoming left_matches with same index
-                auto elit = lit;
-                while(elit != string_matches.cend() && lit->index==elit->index)
-                    ++elit;
-
-                // Get the range of equal string matches on the right side
-                const auto &[eq_begin, eq_end] =
-                        equal_range(other_string_matches.cbegin(), other_string_matches.cend(),
-                                    *lit, [](auto &l, auto &r) { return l.index < r.index; });
-
-                // If no match on the right side continue with next leftmatch
-                if (eq_begin == eq_end){
-                    lit = elit;
-                    continue;
-                }
-
-                // Intersect and aggregate match lengths
-                for (;lit != elit; ++lit)
-                    for (auto rit = eq_begin; rit != eq_end; ++rit)
-                        if (lit->position < rit->position)  // Sequence check
-                            new_string_matches.emplace_back(rit->index, rit->position,
-                                                            rit->match_len + lit->match_len);
-            }
-
-            string_matches = ::move(new_string_matches);
-        }
-
         // Build the list of matched items with their highest scoring match
         for (const auto &match : string_matches)
         {
@@ -398,6 +1375,8 @@ vector<albert::RankItem> ItemIndex::search(const QString &string, const bool &is
                 it->second = score;
         }
 
+        d->addInitialsMatches(words[0], result_map);
+
         // Convert results to return type
         result.reserve(result_map.size());
         for (const auto &[item_idx, score] : result_map)
@@ -406,3 +1385,134 @@ vector<albert::RankItem> ItemIndex::search(const QString &string, const bool &is
     }
     return result;
 }
+
+
+class IndexBuilder::Private
+{
+public:
+    ItemIndex index;
+    function<void(ItemIndex&&)> commit;
+
+    unordered_map<albert::Item*, Index> item_indices;  // implicit unique
+    unordered_map<QString, Index> word_ids;  // in order of appearance
+    vector<vector<Location>> occurrences;  // by word id
+    size_t string_count = 0;  // added strings, including skipped ones
+
+    vector<ItemIndex> shards;  // finished partitions, see ItemIndex::setItems
+
+    /// Finishes the index data and returns the index. Starts a new one.
+    ItemIndex finish();
+};
+
+ItemIndex IndexBuilder::Private::finish()
+{
+    auto &data = index.d->index;
+
+    data.items.shrink_to_fit();
+    data.strings.shrink_to_fit();
+    data.string_word_offsets.emplace_back(data.string_words.size());
+    data.string_word_offsets.shrink_to_fit();
+    data.string_words.shrink_to_fit();
+    item_indices = {};
+    string_count = 0;
+
+    // Sort the words and map the word ids of the forward index to word indices
+
+    vector<pair<QString, Index>> words(make_move_iterator(word_ids.begin()),
+                                       make_move_iterator(word_ids.end()));
+    word_ids = {};
+    ranges::sort(words, {}, &pair<QString, Index>::first);
+
+    vector<Index> word_indices(words.size());
+    data.words.reserve(words.size());
+    for (auto &[word, id] : words)
+    {
+        word_indices[id] = data.words.size();
+        auto &word_index_item = data.words.emplace_back(::move(word), ::move(occurrences[id]));
+        word_index_item.word.shrink_to_fit();
+        word_index_item.occurrences.shrink_to_fit();
+    }
+    words = {};
+    occurrences = {};
+
+    for (auto &word_index : data.string_words)
+        word_index = word_indices[word_index];
+
+    index.d->buildWordLookups(data);
+
+    auto config = index.config();
+    return exchange(index, ItemIndex(::move(config)));
+}
+
+IndexBuilder ItemIndex::builder(MatchConfig config, function<void(ItemIndex&&)> commit)
+{
+    auto d = make_unique<IndexBuilder::Private>(ItemIndex(::move(config)), ::move(commit));
+    return IndexBuilder(::move(d));
+}
+
+IndexBuilder::IndexBuilder(unique_ptr<Private> p) : d(::move(p)) {}
+
+IndexBuilder::IndexBuilder(IndexBuilder &&) = default;
+
+IndexBuilder &IndexBuilder::operator=(IndexBuilder &&) = default;
+
+IndexBuilder::~IndexBuilder() = default;
+
+void IndexBuilder::add(shared_ptr<Item> item, const QString &string)
+{
+    // Partition large indexes the same way ItemIndex::setItems does
+    if (d->string_count == search_shard_size)
+        d->shards.emplace_back(d->finish());
+    ++d->string_count;
+
+    auto &index = d->index.d->index;
+
+    QString initials;
+    const auto words = d->index.d->tokenize(string, d->index.d->config.initials ? &initials
+                                                                                 : nullptr);
+    if (words.empty())
+    {
+        WARN << QString("Skipping index entry '%1'. Tokenization of '%2' yields empty set.")
+                    .arg(item->id(), string);
+        return;
+    }
+
+    // Try to add the item to the temporary item index map (ensures uniqueness)
+    const auto &[it, emplaced] = d->item_indices.emplace(item.get(), (Index)index.items.size());
+    if (emplaced)
+        index.items.emplace_back(::move(item));
+
+    const Index string_index = index.strings.size();
+    auto &string_index_item = index.strings.emplace_back(it->second, 0);
+    index.string_word_offsets.emplace_back(index.string_words.size());
+
+    for (Position p = 0; p < (Position)words.size(); ++p)
+    {
+        // The forward index holds word ids until commit
+        const auto &[wit, new_word] = d->word_ids.emplace(words[p], (Index)d->word_ids.size());
+        if (new_word)
+            d->occurrences.emplace_back();
+        d->occurrences[wit->second].emplace_back(string_index, p);
+        index.string_words.emplace_back(wit->second);
+
+        // Store the maximal match length for scoring
+        string_index_item.max_match_len += words[p].size();
+    }
+
+    if (initials.size() >= min_initials_length)
+        index.initials.emplace_back(::move(initials), string_index);
+}
+
+void IndexBuilder::commit()
+{
+    auto index = d->finish();
+
+    if (!d->shards.empty())
+    {
+        d->shards.emplace_back(::move(index));
+        index = ItemIndex(d->index.config());
+        index.d->shards = exchange(d->shards, {});
+    }
+
+    d->commit(::move(index));
+}
@@ -3,9 +3,11 @@
 #pragma once
 #include <QString>
 #include <albert/export.h>
+#include <albert/indexbuilder.h>
 #include <albert/indexitem.h>
 #include <albert/matchconfig.h>
 #include <albert/rankitem.h>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -34,9 +36,17 @@ public:
     /// @return A list of scored items.
     std::vector<albert::RankItem> search(const QString &string, const bool &isValid) const;
 
+    /// Returns a streaming builder for an index with config `config`.
+    /// @param commit Called with the built index on commit.
+    static albert::util::IndexBuilder builder(albert::util::MatchConfig config,
+                                              std::function<void(ItemIndex&&)> commit);
+
 private:
 
     class Private;
     std::unique_ptr<Private> d;
 
+    friend class albert::util::IndexBuilder;
+    friend class albert::util::IndexBuilder::Private;
+
 };
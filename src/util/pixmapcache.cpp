@@ -0,0 +1,232 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#include "logging.h"
+#include "pixmapcache.h"
+#include <QDir>
+#include <QEvent>
+#include <QHashFunctions>
+#include <QIcon>
+#include <QObject>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+static const size_t default_capacity = 32 * 1024 * 1024;
+static const QString &file_scheme = u"file:"_s;
+
+size_t PixmapCache::KeyHash::operator()(const Key &k) const noexcept
+{ return qHashMulti(0, k.url, k.size.width(), k.size.height(), k.dpr); }
+
+/// Returns the modification time of the file of file urls and absolute paths. Returns the
+/// default time for other urls and files that do not exist.
+static filesystem::file_time_type modificationTime(const QString &url)
+{
+    QString path;
+    if (url.startsWith(file_scheme))
+        path = url.mid(file_scheme.size());
+    else if (!url.startsWith(u':') && QDir::isAbsolutePath(url))  // qrc paths are absolute
+        path = url;
+    else
+        return {};
+
+    error_code ec;
+    const auto mtime = filesystem::last_write_time(filesystem::path(path.toStdString()), ec);
+    return ec ? filesystem::file_time_type{} : mtime;
+}
+
+/// Forwards theme change events to the cache. Lives in the GUI thread.
+class ThemeChangeFilter : public QObject
+{
+public:
+    using QObject::QObject;
+
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::ThemeChange)
+            PixmapCache::instance().setThemeName(QIcon::themeName());
+        return QObject::eventFilter(watched, event);
+    }
+};
+
+PixmapCache::PixmapCache() : capacity_(default_capacity) {}
+
+PixmapCache &PixmapCache::instance()
+{
+    static PixmapCache instance;
+    return instance;
+}
+
+QPixmap PixmapCache::get(const Key &key, const function<QPixmap()> &render)
+{
+    // Stat before locking, changes during the render invalidate the entry on the next access
+    const auto mtime = modificationTime(key.url);
+
+    unique_lock lock(mutex_);
+
+    if (auto pm = find_(key, mtime); pm)
+        return *pm;
+
+    if (auto it = in_flight_.find(key); it != in_flight_.end())
+    {
+        ++shared_;
+        auto future = it->second;
+        lock.unlock();
+        return future.get();
+    }
+
+    ++misses_;
+    promise<QPixmap> promise;
+    in_flight_.emplace(key, promise.get_future().share());
+    lock.unlock();
+
+    QPixmap pixmap;
+    try {
+        pixmap = render();
+    } catch (...) {
+        lock.lock();
+        in_flight_.erase(key);
+        lock.unlock();
+        promise.set_exception(current_exception());
+        throw;
+    }
+
+    lock.lock();
+    in_flight_.erase(key);
+    insert_(key, pixmap, mtime);
+    lock.unlock();
+
+    promise.set_value(pixmap);
+    return pixmap;
+}
+
+optional<QPixmap> PixmapCache::lookup(const Key &key)
+{
+    const auto mtime = modificationTime(key.url);
+    lock_guard lock(mutex_);
+    return find_(key, mtime);
+}
+
+void PixmapCache::insert(const Key &key, const QPixmap &pixmap)
+{
+    const auto mtime = modificationTime(key.url);
+    lock_guard lock(mutex_);
+    insert_(key, pixmap, mtime);
+}
+
+void PixmapCache::clear()
+{
+    lock_guard lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+void PixmapCache::setThemeName(const QString &theme_name)
+{
+    lock_guard lock(mutex_);
+    if (theme_name != theme_name_)
+    {
+        DEBG << QString("Icon theme changed from '%1' to '%2'. Clearing pixmap cache.")
+                    .arg(theme_name_, theme_name);
+        theme_name_ = theme_name;
+        lru_.clear();
+        index_.clear();
+        bytes_ = 0;
+    }
+}
+
+QString PixmapCache::themeName() const
+{
+    lock_guard lock(mutex_);
+    return theme_name_;
+}
+
+void PixmapCache::watchThemeChanges(QObject *application)
+{
+    {
+        lock_guard lock(mutex_);
+        theme_name_ = QIcon::themeName();
+    }
+    application->installEventFilter(new ThemeChangeFilter(application));
+}
+
+size_t PixmapCache::capacity() const
+{
+    lock_guard lock(mutex_);
+    return capacity_;
+}
+
+void PixmapCache::setCapacity(size_t bytes)
+{
+    lock_guard lock(mutex_);
+    capacity_ = bytes;
+    evict_();
+}
+
+PixmapCache::Statistics PixmapCache::statistics() const
+{
+    lock_guard lock(mutex_);
+    return {
+        .hits = hits_,
+        .misses = misses_,
+        .shared = shared_,
+        .evictions = evictions_,
+        .entries = lru_.size(),
+        .bytes = bytes_,
+        .capacity = capacity_
+    };
+}
+
+optional<QPixmap> PixmapCache::find_(const Key &key, filesystem::file_time_type mtime)
+{
+    if (auto it = index_.find(key); it == index_.end())
+        return {};
+
+    else if (it->second->mtime != mtime)  // file changed
+    {
+        erase_(it);
+        return {};
+    }
+
+    else
+    {
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->pixmap;
+    }
+}
+
+void PixmapCache::insert_(const Key &key, const QPixmap &pixmap, filesystem::file_time_type mtime)
+{
+    // Null pixmaps cost their bookkeeping only
+    size_t cost = sizeof(Entry) + (size_t)key.url.size() * sizeof(QChar);
+    if (!pixmap.isNull())
+        cost += (size_t)pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+
+    if (auto it = index_.find(key); it != index_.end())
+        erase_(it);
+
+    if (cost > capacity_)
+        return;
+
+    lru_.emplace_front(key, pixmap, cost, mtime);
+    index_.emplace(key, lru_.begin());
+    bytes_ += cost;
+
+    evict_();
+}
+
+void PixmapCache::erase_(Iterator it)
+{
+    bytes_ -= it->second->cost;
+    lru_.erase(it->second);
+    index_.erase(it);
+}
+
+void PixmapCache::evict_()
+{
+    while (bytes_ > capacity_ && !lru_.empty())
+    {
+        erase_(index_.find(lru_.back().key));
+        ++evictions_;
+    }
+}
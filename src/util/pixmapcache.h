@@ -0,0 +1,114 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#pragma once
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+///
+/// Thread-safe, size bounded LRU cache of rendered pixmaps.
+///
+/// Entries are keyed by icon url, requested size and device pixel ratio. Concurrent renders of
+/// the same key share a single result. Null pixmaps are cached as well, since failing lookups
+/// tend to be the most expensive ones. Entries of file urls are dropped on access if the
+/// modification time of the file changed. The cache is invalidated when the icon theme changes,
+/// see watchThemeChanges().
+///
+class PixmapCache
+{
+public:
+
+    struct Key
+    {
+        QString url;
+        QSize size;
+        qreal dpr;
+
+        bool operator==(const Key &) const = default;
+    };
+
+    struct Statistics
+    {
+        uint64_t hits;       ///< Lookups served from the cache.
+        uint64_t misses;     ///< Lookups that had to render.
+        uint64_t shared;     ///< Lookups that joined a render already in flight.
+        uint64_t evictions;  ///< Entries dropped to stay within the capacity.
+        size_t entries;      ///< Current number of entries.
+        size_t bytes;        ///< Current (approximate) memory footprint.
+        size_t capacity;     ///< The memory limit in bytes.
+    };
+
+    static PixmapCache &instance();
+
+    /// Returns the cached pixmap for `key` or renders, caches and returns it using `render`.
+    /// If another thread is rendering the same key, waits for and returns its result.
+    QPixmap get(const Key &key, const std::function<QPixmap()> &render);
+
+    /// Returns the cached pixmap for `key`, if any. Does not count as miss.
+    std::optional<QPixmap> lookup(const Key &key);
+
+    /// Inserts or replaces the entry for `key`.
+    void insert(const Key &key, const QPixmap &pixmap);
+
+    /// Drops all entries.
+    void clear();
+
+    /// Drops all entries if `theme_name` is not the name of the current icon theme.
+    /// Themed icons are resolved at render time, i.e. the entries depend on the theme.
+    void setThemeName(const QString &theme_name);
+
+    /// Returns the name of the icon theme as of the last theme change event, empty until
+    /// watchThemeChanges() has been called. Use this instead of QIcon::themeName() off the GUI
+    /// thread.
+    QString themeName() const;
+
+    /// Calls setThemeName() with the name of the icon theme on theme change events of
+    /// `application`. Call this in the GUI thread.
+    void watchThemeChanges(QObject *application);
+
+    size_t capacity() const;
+    void setCapacity(size_t bytes);
+
+    Statistics statistics() const;
+
+private:
+
+    PixmapCache();
+
+    struct KeyHash { size_t operator()(const Key &) const noexcept; };
+
+    struct Entry
+    {
+        Key key;
+        QPixmap pixmap;
+        size_t cost;
+        std::filesystem::file_time_type mtime;
+    };
+
+    using Iterator = std::unordered_map<Key, std::list<Entry>::iterator, KeyHash>::iterator;
+
+    std::optional<QPixmap> find_(const Key &key, std::filesystem::file_time_type mtime);
+    void insert_(const Key &key, const QPixmap &pixmap, std::filesystem::file_time_type mtime);
+    void erase_(Iterator it);
+    void evict_();
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;  // front: most recently used
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    std::unordered_map<Key, std::shared_future<QPixmap>, KeyHash> in_flight_;
+    QString theme_name_;
+    size_t capacity_;
+    size_t bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t shared_ = 0;
+    uint64_t evictions_ = 0;
+
+};
@@ -0,0 +1,280 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#include "albert.h"
+#include "logging.h"
+#include "settingsstore.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QFuture>
+#include <QSettings>
+#include <QTimer>
+#include <QtConcurrentRun>
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+using namespace albert::util;
+using namespace albert;
+using namespace std;
+
+static const int write_back_delay = 500;  // ms
+
+using Snapshot = map<QString, QVariant>;
+
+// The modification time of the file including its size, to notice changes within the
+// resolution of the timestamp.
+using FileStamp = pair<filesystem::file_time_type, uintmax_t>;
+
+static FileStamp fileStamp(const QString &path)
+{
+    error_code ec;
+    const filesystem::path p(path.toStdString());
+    const auto mtime = filesystem::last_write_time(p, ec);
+    if (ec)
+        return {};
+    const auto size = filesystem::file_size(p, ec);
+    return {mtime, ec ? 0 : size};
+}
+
+static bool isSubkey(const QString &key, const QString &group)
+{ return key.size() > group.size() && key.startsWith(group) && key[group.size()] == u'/'; }
+
+// Values read from the file have their INI representation, e.g. "true" for true. Compares the
+// values in the representation of the string (list) one, if any.
+static bool isEquivalent(const QVariant &a, const QVariant &b)
+{
+    if (a == b)
+        return true;
+
+    for (const auto &[x, y] : {pair{&a, &b}, pair{&b, &a}})
+        if (x->typeId() == QMetaType::QString || x->typeId() == QMetaType::QStringList)
+            if (auto c = *y; c.convert(x->metaType()) && c == *x)
+                return true;
+
+    return false;
+}
+
+
+class SettingsStore::Private
+{
+public:
+
+    struct Op
+    {
+        QString key;
+        optional<QVariant> value;  // nullopt: remove
+    };
+
+    const QString path;
+
+    // Readers load the snapshot without taking any lock of the store
+#if defined(__cpp_lib_atomic_shared_ptr)
+    atomic<shared_ptr<const Snapshot>> snapshot;
+    shared_ptr<const Snapshot> load() const { return snapshot.load(); }
+    void store(shared_ptr<const Snapshot> s) { snapshot.store(::move(s)); }
+#else
+    shared_ptr<const Snapshot> snapshot;
+    shared_ptr<const Snapshot> load() const { return atomic_load(&snapshot); }
+    void store(shared_ptr<const Snapshot> s) { atomic_store(&snapshot, ::move(s)); }
+#endif
+
+    std::mutex snapshot_mutex;  // serializes snapshot updates, guards pending
+    vector<Op> pending;         // changes not yet written to the file, in order
+
+    std::mutex file_mutex;      // serializes file access, guards file_stamp
+    FileStamp file_stamp;       // of the last read or write
+
+    QTimer *timer;
+    QFuture<void> write_back;
+
+    static void apply(Snapshot &s, const Op &op)
+    {
+        if (op.value)
+            s[op.key] = *op.value;
+        else
+        {
+            s.erase(op.key);
+            for (auto it = s.upper_bound(op.key); it != s.end() && it->first.startsWith(op.key);)
+                if (isSubkey(it->first, op.key))
+                    it = s.erase(it);
+                else
+                    ++it;
+        }
+    }
+
+    void scheduleWriteBack()
+    {
+        // Restarting the timer debounces the write-back. The timer lives in the main thread.
+        QMetaObject::invokeMethod(timer, [t=timer]{ t->start(); });
+    }
+
+    void writeBack()
+    {
+        lock_guard file_lock(file_mutex);
+
+        vector<Op> ops;
+        {
+            lock_guard lock(snapshot_mutex);
+            ops.swap(pending);
+        }
+
+        if (ops.empty())
+            return;
+
+        QSettings s(path, QSettings::IniFormat);
+        for (const auto &op : ops)
+            if (op.value)
+                s.setValue(op.key, *op.value);
+            else
+                s.remove(op.key);
+        s.sync();
+
+        if (s.status() != QSettings::NoError)
+            WARN << "Failed to write settings:" << path;
+
+        file_stamp = fileStamp(path);
+        DEBG << QString("Wrote %1 settings changes to '%2'.").arg(ops.size()).arg(path);
+    }
+
+    /// Reads the file if it changed and returns the keys that changed.
+    vector<pair<QString, QVariant>> read()
+    {
+        lock_guard file_lock(file_mutex);
+
+        if (const auto stamp = fileStamp(path); stamp == file_stamp && load())
+            return {};
+        else
+            file_stamp = stamp;
+
+        auto fresh = make_shared<Snapshot>();
+        QSettings s(path, QSettings::IniFormat);
+        for (const auto &key : s.allKeys())
+            fresh->emplace(key, s.value(key));
+
+        lock_guard lock(snapshot_mutex);
+
+        // Changes not yet written to the file still apply
+        for (const auto &op : pending)
+            apply(*fresh, op);
+
+        vector<pair<QString, QVariant>> changes;
+        if (const auto old = load(); old)
+        {
+            for (const auto &[key, value] : *old)
+                if (auto it = fresh->find(key); it == fresh->end())
+                    changes.emplace_back(key, QVariant{});
+                else if (!isEquivalent(it->second, value))
+                    changes.emplace_back(key, it->second);
+            for (const auto &[key, value] : *fresh)
+                if (!old->contains(key))
+                    changes.emplace_back(key, value);
+        }
+
+        store(::move(fresh));
+        return changes;
+    }
+};
+
+
+SettingsStore::SettingsStore(const QString &fileName):
+    d(new Private{.path = fileName, .timer = new QTimer(this)})
+{
+    d->timer->setSingleShot(true);
+    d->timer->setInterval(write_back_delay);
+    connect(d->timer, &QTimer::timeout, this,
+            [this]{ d->write_back = QtConcurrent::run([this]{ d->writeBack(); }); });
+
+    d->read();
+
+    // Stores may be created in any thread, the timer has to live in the main thread
+    if (auto *app = QCoreApplication::instance())
+    {
+        moveToThread(app->thread());
+        connect(app, &QCoreApplication::aboutToQuit, this, &SettingsStore::sync);
+    }
+}
+
+SettingsStore::~SettingsStore()
+{
+    d->write_back.waitForFinished();
+    d->writeBack();
+}
+
+SettingsStore &SettingsStore::config()
+{
+    static SettingsStore store(QString::fromStdString((configLocation() / "config").string()));
+    return store;
+}
+
+SettingsStore &SettingsStore::state()
+{
+    static SettingsStore store(QString::fromStdString((cacheLocation() / "state").string()));
+    return store;
+}
+
+const QString &SettingsStore::fileName() const { return d->path; }
+
+QVariant SettingsStore::value(const QString &key, const QVariant &defaultValue) const
+{
+    const auto snapshot = d->load();
+    if (auto it = snapshot->find(key); it != snapshot->end())
+        return it->second;
+    return defaultValue;
+}
+
+bool SettingsStore::contains(const QString &key) const { return d->load()->contains(key); }
+
+void SettingsStore::setValue(const QString &key, const QVariant &value)
+{
+    {
+        lock_guard lock(d->snapshot_mutex);
+
+        const auto snapshot = d->load();
+        if (auto it = snapshot->find(key); it != snapshot->end() && isEquivalent(it->second, value))
+            return;
+
+        Private::Op op{key, value};
+        auto next = make_shared<Snapshot>(*snapshot);  // copy on write
+        Private::apply(*next, op);
+        d->store(::move(next));
+        d->pending.emplace_back(::move(op));
+    }
+
+    d->scheduleWriteBack();
+    emit valueChanged(key, value);
+}
+
+void SettingsStore::remove(const QString &key)
+{
+    QStringList removed;
+    {
+        lock_guard lock(d->snapshot_mutex);
+
+        const auto snapshot = d->load();
+        for (auto it = snapshot->lower_bound(key); it != snapshot->end() && it->first.startsWith(key); ++it)
+            if (it->first == key || isSubkey(it->first, key))
+                removed << it->first;
+
+        if (removed.isEmpty())
+            return;
+
+        Private::Op op{key, nullopt};
+        auto next = make_shared<Snapshot>(*snapshot);
+        Private::apply(*next, op);
+        d->store(::move(next));
+        d->pending.emplace_back(::move(op));
+    }
+
+    d->scheduleWriteBack();
+    for (const auto &k : removed)
+        emit valueChanged(k, {});
+}
+
+void SettingsStore::sync() { d->writeBack(); }  // serialized with running write-backs
+
+void SettingsStore::reload()
+{
+    for (const auto &[key, value] : d->read())
+        emit valueChanged(key, value);
+}
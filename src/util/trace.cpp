@@ -0,0 +1,163 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#include "trace.h"
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+using namespace std::chrono;
+using namespace std;
+
+static const size_t buffer_capacity = 8192;  // spans per thread
+
+atomic<bool> Trace::enabled_ = qEnvironmentVariableIsSet("ALBERT_TRACE");
+
+namespace
+{
+
+struct Span
+{
+    const char *name;
+    QString detail;
+    qint64 begin;
+    qint64 end;
+};
+
+class ThreadBuffer
+{
+public:
+
+    ThreadBuffer(int t, QString n) : tid(t), thread_name(::move(n))
+    { spans.reserve(buffer_capacity); }
+
+    const int tid;
+    const QString thread_name;
+    bool finished = false;  // the thread exited
+
+    mutex m;  // uncontended except while exporting
+    vector<Span> spans;
+    size_t next = 0;
+
+    void push(Span &&span)
+    {
+        lock_guard lock(m);
+        if (spans.size() < buffer_capacity)
+            spans.emplace_back(::move(span));
+        else
+            spans[next] = ::move(span);
+        next = (next + 1) % buffer_capacity;
+    }
+};
+
+mutex buffers_mutex;
+vector<shared_ptr<ThreadBuffer>> buffers;
+int thread_count = 0;
+
+const steady_clock::time_point epoch = steady_clock::now();
+
+ThreadBuffer &threadBuffer()
+{
+    // Owns the buffer of the thread and marks it finished on thread exit
+    struct Holder
+    {
+        shared_ptr<ThreadBuffer> buffer;
+
+        Holder()
+        {
+            QString name;
+            if (auto *t = QThread::currentThread(); t)
+            {
+                if (auto *app = QCoreApplication::instance(); app && app->thread() == t)
+                    name = QStringLiteral("main");
+                else
+                    name = t->objectName();
+            }
+
+            lock_guard lock(buffers_mutex);
+            const auto tid = ++thread_count;
+            if (name.isEmpty())
+                name = QStringLiteral("thread %1").arg(tid);
+            buffer = make_shared<ThreadBuffer>(tid, name);
+            buffers.emplace_back(buffer);
+        }
+
+        ~Holder()
+        {
+            lock_guard lock(buffers_mutex);
+            buffer->finished = true;
+        }
+    };
+
+    thread_local Holder holder;
+    return *holder.buffer;
+}
+
+}
+
+
+void Trace::setEnabled(bool enabled) { enabled_.store(enabled, memory_order_relaxed); }
+
+void Trace::clear()
+{
+    lock_guard lock(buffers_mutex);
+    erase_if(buffers, [](const auto &b){ return b->finished; });
+    for (auto &b : buffers)
+    {
+        lock_guard buffer_lock(b->m);
+        b->spans.clear();
+        b->next = 0;
+    }
+}
+
+qint64 Trace::now() { return duration_cast<microseconds>(steady_clock::now() - epoch).count(); }
+
+void Trace::record(const char *name, const QString &detail, qint64 begin, qint64 end)
+{ threadBuffer().push({name, detail, begin, end}); }
+
+QByteArray Trace::chromeTraceJson()
+{
+    const auto pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+
+    lock_guard lock(buffers_mutex);
+    for (const auto &b : buffers)
+    {
+        lock_guard buffer_lock(b->m);
+        if (b->spans.empty())
+            continue;
+
+        events.append(QJsonObject{
+            {"name", "thread_name"},
+            {"ph", "M"},
+            {"pid", pid},
+            {"tid", b->tid},
+            {"args", QJsonObject{{"name", b->thread_name}}}
+        });
+
+        for (const auto &s : b->spans)
+        {
+            QJsonObject event{
+                {"name", s.name},
+                {"cat", "albert"},
+                {"ph", "X"},
+                {"ts", s.begin},
+                {"dur", s.end - s.begin},
+                {"pid", pid},
+                {"tid", b->tid}
+            };
+            if (!s.detail.isEmpty())
+                event.insert("args", QJsonObject{{"detail", s.detail}});
+            events.append(event);
+        }
+    }
+
+    return QJsonDocument(QJsonObject{
+        {"traceEvents", events},
+        {"displayTimeUnit", "ms"}
+    }).toJson(QJsonDocument::Compact);
+}
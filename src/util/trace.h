@@ -0,0 +1,82 @@
+// Copyright (c) 2025 Manuel Schneider
+
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+
+///
+/// Lightweight span tracing.
+///
+/// Spans are recorded into preallocated, fixed size, thread-local ring buffers, i.e. old spans are
+/// overwritten. The lock of a buffer is contended by exports only. If tracing is disabled a span
+/// costs a relaxed atomic load. Enable using the `trace` RPC command or by setting the
+/// environment variable ALBERT_TRACE.
+///
+/// The recorded spans can be exported in the Chrome trace event format, which can be viewed
+/// using chrome://tracing or https://ui.perfetto.dev.
+///
+class Trace
+{
+public:
+
+    /// Returns true if spans are recorded.
+    static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    /// Enables or disables recording.
+    static void setEnabled(bool enabled);
+
+    /// Drops all recorded spans.
+    static void clear();
+
+    /// Returns the current time in microseconds on the trace clock.
+    static qint64 now();
+
+    /// Records a span of the current thread. `name` has to be a string literal.
+    static void record(const char *name, const QString &detail, qint64 begin, qint64 end);
+
+    /// Returns the recorded spans of all threads in the Chrome trace event JSON format.
+    static QByteArray chromeTraceJson();
+
+private:
+
+    static std::atomic<bool> enabled_;
+
+};
+
+
+///
+/// Records the lifetime of the object as span, if tracing is enabled.
+///
+/// `name` has to be a string literal. `detail` is shown as argument of the span.
+///
+class TraceSpan
+{
+public:
+
+    explicit TraceSpan(const char *name, const QString &detail = {})
+    {
+        if (Trace::isEnabled())
+        {
+            name_ = name;
+            detail_ = detail;
+            begin_ = Trace::now();
+        }
+    }
+
+    ~TraceSpan()
+    {
+        if (name_)
+            Trace::record(name_, detail_, begin_, Trace::now());
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+
+    const char *name_ = nullptr;
+    QString detail_;
+    qint64 begin_;
+
+};
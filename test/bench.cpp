@@ -0,0 +1,469 @@
+// Copyright (c) 2025 Manuel Schneider
+
+// Benchmark suite of the matching, indexing and query pipeline.
+//
+// The corpora are generated from a fixed seed, i.e. the results of different builds are
+// comparable. Prints the results as JSON, see --help.
+
+#include "albert.h"
+#include "config.h"
+#include "extensionregistry.h"
+#include "globalqueryhandler.h"
+#include "itemindex.h"
+#include "matcher.h"
+#include "queryengine.h"
+#include "queryexecution.h"
+#include "standarditem.h"
+#include "usagedatabase.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <tuple>
+using namespace albert::util;
+using namespace albert;
+using namespace std::chrono;
+using namespace std;
+
+static const uint seed = 42;
+static const QStringList corpus_kinds{"apps", "paths", "unicode"};
+static const vector<int> query_lengths{1, 2, 4, 8};
+static const int queries_per_length = 8;
+static const uint global_handler_count = 4;
+
+
+// -------------------------------------------------------------------------------------------------
+// Corpora
+
+static QString word(mt19937 &rng, const QStringList &syllables, uint min, uint max)
+{
+    uniform_int_distribution<uint> count(min, max);
+    uniform_int_distribution<qsizetype> syllable(0, syllables.size() - 1);
+    QString w;
+    for (auto n = count(rng); n > 0; --n)
+        w += syllables[syllable(rng)];
+    return w;
+}
+
+static QString words(mt19937 &rng, const QStringList &syllables, uint max_words, QChar separator)
+{
+    uniform_int_distribution<uint> count(1, max_words);
+    QStringList l;
+    for (auto n = count(rng); n > 0; --n)
+        l << word(rng, syllables, 1, 3);
+    return l.join(separator);
+}
+
+/// Returns `size` strings of kind `kind`. Application names, file paths or unicode strings
+/// containing diacritics and non latin scripts.
+static vector<QString> corpus(const QString &kind, size_t size)
+{
+    static const QStringList ascii{
+        "al", "be", "cor", "da", "el", "fi", "gen", "ho", "ix", "ja", "ka", "lu", "mo",
+        "nex", "or", "pa", "qu", "ri", "so", "ta", "un", "vi", "wo", "xy", "ze"
+    };
+    static const QStringList unicode{
+        "é", "ü", "ø", "ñ", "ç", "å", "ß", "ï", "ô", "ł", "ž", "ă", "al", "be", "ko", "ri",
+        "ta", "mu", "на", "ло", "ви", "東", "京", "γα", "λφ"
+    };
+    static const QStringList dirs{
+        "usr", "share", "local", "home", "user", "projects", "src", "lib", "docs", "config",
+        "cache", "build"
+    };
+    static const QStringList suffixes{
+        ".txt", ".cpp", ".h", ".png", ".pdf", ".desktop", ".json", ".md"
+    };
+
+    mt19937 rng(seed);
+    uniform_int_distribution<qsizetype> dir(0, dirs.size() - 1);
+    uniform_int_distribution<qsizetype> suffix(0, suffixes.size() - 1);
+    uniform_int_distribution<uint> depth(1, 5);
+
+    vector<QString> strings;
+    strings.reserve(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (kind == QStringLiteral("apps"))
+        {
+            auto s = words(rng, ascii, 3, u' ');
+            s[0] = s[0].toUpper();
+            strings.emplace_back(::move(s));
+        }
+        else if (kind == QStringLiteral("paths"))
+        {
+            QString s;
+            for (auto n = depth(rng); n > 0; --n)
+                s += u'/' + dirs[dir(rng)];
+            s += u'/' + words(rng, ascii, 2, u'_') + suffixes[suffix(rng)];
+            strings.emplace_back(::move(s));
+        }
+        else
+            strings.emplace_back(words(rng, unicode, 3, u' '));
+    }
+    return strings;
+}
+
+static vector<IndexItem> indexItems(const vector<QString> &strings)
+{
+    vector<IndexItem> items;
+    items.reserve(strings.size());
+    for (size_t i = 0; i < strings.size(); ++i)
+        items.emplace_back(StandardItem::make(QString::number(i), strings[i]), strings[i]);
+    return items;
+}
+
+/// Returns queries of `length` starting at random word boundaries of `strings`. If `typo` is set
+/// the last char is replaced, to exercise error tolerant matching.
+static QStringList queries(const vector<QString> &strings, int length, bool typo)
+{
+    static const QRegularExpression word_start(QStringLiteral("(?<![^\\s/_.])[^\\s/_.]"));
+    mt19937 rng(seed + length);
+    uniform_int_distribution<size_t> pick(0, strings.size() - 1);
+
+    QStringList l;
+    for (int attempts = 0; l.size() < queries_per_length && attempts < 1000; ++attempts)
+    {
+        const auto &s = strings[pick(rng)];
+        QList<qsizetype> starts;
+        for (const auto &m : word_start.globalMatch(s))
+            starts << m.capturedStart();
+        if (starts.isEmpty())
+            continue;
+
+        auto q = s.mid(starts[rng() % starts.size()], length);
+        if (q.size() < length)
+            continue;
+        if (typo && length > 3)
+            q.back() = q.back() == u'x' ? u'y' : u'x';
+        l << q;
+    }
+    return l;
+}
+
+
+// -------------------------------------------------------------------------------------------------
+// Measurement
+
+class Benchmark
+{
+public:
+
+    Benchmark(const QCommandLineParser &p):
+        filter(p.value("filter")),
+        budget(p.value("time").toInt())
+    {}
+
+    /// Runs `f` repeatedly for the time budget (at least once) and records the timings.
+    /// `items` is the amount of items processed per run, used to compute the throughput.
+    void run(const QString &name, QJsonObject params, const function<void()> &f, size_t items = 0)
+    {
+        if (!filter.match(name).hasMatch())
+            return;
+
+        vector<double> samples;  // ns
+        const auto end = steady_clock::now() + budget;
+        do {
+            const auto t = steady_clock::now();
+            f();
+            samples.push_back(duration<double, nano>(steady_clock::now() - t).count());
+        } while (steady_clock::now() < end);
+
+        ranges::sort(samples);
+        double sum = 0;
+        for (auto s : samples)
+            sum += s;
+        const auto median = samples[samples.size() / 2];
+
+        params.insert("name", name);
+        params.insert("iterations", (qint64)samples.size());
+        params.insert("min_ns", samples.front());
+        params.insert("median_ns", median);
+        params.insert("mean_ns", sum / samples.size());
+        params.insert("max_ns", samples.back());
+        if (items > 0)
+            params.insert("items_per_s", items / median * 1e9);
+        results.append(params);
+
+        QTextStream(stderr) << QJsonDocument(params).toJson(QJsonDocument::Compact) << Qt::endl;
+    }
+
+    bool enabled(const QString &name) const { return filter.match(name).hasMatch(); }
+
+    QJsonArray results;
+
+private:
+
+    const QRegularExpression filter;
+    const milliseconds budget;
+
+};
+
+
+// -------------------------------------------------------------------------------------------------
+// Benchmarks
+
+static void benchmarkIndex(Benchmark &b, const QString &kind, const vector<QString> &strings)
+{
+    const QJsonObject base{{"corpus", kind}, {"size", (qint64)strings.size()}};
+
+    using enum MatchConfig::FuzzyLookup;
+    const vector<tuple<bool, MatchConfig::FuzzyLookup, uint, QString>> configs{
+        {false, NGram, 0, {}},
+        {true, NGram, 0, "ngram"},
+        {true, Automaton, 0, "automaton"},
+        {true, NGram, 6, "ngram"},
+    };
+
+    for (const auto &[fuzzy, lookup, typo_index_length, lookup_name] : configs)
+    {
+        auto params = base;
+        params.insert("fuzzy", fuzzy);
+        if (fuzzy)
+        {
+            params.insert("fuzzy_lookup", lookup_name);
+            params.insert("typo_index_length", (qint64)typo_index_length);
+        }
+        const MatchConfig config{.fuzzy = fuzzy,
+                                 .fuzzy_lookup = lookup,
+                                 .typo_index_length = typo_index_length};
+
+        // Includes the creation of the items, setItems consumes them
+        b.run("index_build", params, [&]{
+            ItemIndex index(config);
+            index.setItems(indexItems(strings));
+        }, strings.size());
+
+        if (!b.enabled("index_search"))
+            continue;
+
+        ItemIndex index(config);
+        index.setItems(indexItems(strings));
+
+        const bool valid = true;
+        for (auto length : query_lengths)
+        {
+            const auto qs = queries(strings, length, fuzzy);
+            auto p = params;
+            p.insert("query_length", length);
+            b.run("index_search", p, [&]{
+                for (const auto &q : qs)
+                    index.search(q, valid);
+            }, qs.size());
+        }
+    }
+}
+
+static void benchmarkMatcher(Benchmark &b, const QString &kind, const vector<QString> &strings)
+{
+    for (bool fuzzy : {false, true})
+        for (auto length : query_lengths)
+        {
+            const auto qs = queries(strings, length, fuzzy);
+            if (qs.empty())
+                continue;
+
+            const Matcher matcher(qs.front(), {.fuzzy = fuzzy});
+            b.run("matcher_match",
+                  {{"corpus", kind}, {"size", (qint64)strings.size()},
+                   {"fuzzy", fuzzy}, {"query_length", length}},
+                  [&]{
+                      size_t n = 0;
+                      for (const auto &s : strings)
+                          n += matcher.match(s).isMatch();
+                      volatile auto sink = n;
+                      (void)sink;
+                  }, strings.size());
+        }
+}
+
+static vector<RankItem> rankItems(const vector<QString> &strings)
+{
+    mt19937 rng(seed);
+    uniform_real_distribution<double> score(0.0, 1.0);
+    vector<RankItem> items;
+    items.reserve(strings.size());
+    for (size_t i = 0; i < strings.size(); ++i)
+        items.emplace_back(StandardItem::make(QString::number(i), strings[i]), score(rng));
+    return items;
+}
+
+static void benchmarkScoring(Benchmark &b, const QString &kind, const vector<QString> &strings)
+{
+    const QJsonObject params{{"corpus", kind}, {"size", (qint64)strings.size()}};
+    const auto items = rankItems(strings);
+
+    if (b.enabled("usage_scoring"))
+    {
+        // Activate every 100th item, at most 100 items
+        const auto extension_id = QStringLiteral("bench_%1").arg(kind);
+        for (size_t i = 0; i < strings.size() && i < 10000; i += 100)
+            UsageHistory::addActivation(strings[i], extension_id, QString::number(i), "0");
+
+        auto copy = items;
+        b.run("usage_scoring", params, [&]{
+            ranges::copy(items, copy.begin());
+            UsageHistory::applyScores(extension_id, copy);
+        }, items.size());
+    }
+
+    // Same order as the global query
+    static const auto cmp = [](const RankItem &a, const RankItem &b){
+        if (a.score == b.score)
+            return a.item->text() > b.item->text();
+        else
+            return a.score > b.score;
+    };
+
+    auto copy = items;
+    b.run("result_sorting", params, [&]{
+        ranges::copy(items, copy.begin());
+        auto mid = copy.begin() + min<size_t>(20, copy.size());
+        partial_sort(copy.begin(), mid, copy.end(), cmp);
+        sort(mid, copy.end(), cmp);
+    }, items.size());
+}
+
+
+class BenchQueryHandler : public GlobalQueryHandler
+{
+public:
+
+    BenchQueryHandler(QString id, vector<IndexItem> &&items) : id_(::move(id))
+    { index_.setItems(::move(items)); }
+
+    QString id() const override { return id_; }
+    QString name() const override { return id_; }
+    QString description() const override { return id_; }
+
+    vector<RankItem> handleGlobalQuery(const Query &query) override
+    { return index_.search(query.string(), query.isValid()); }
+
+private:
+
+    const QString id_;
+    ItemIndex index_;
+
+};
+
+static void benchmarkGlobalQuery(Benchmark &b, QueryEngine &engine, ExtensionRegistry &registry,
+                                 const QString &kind, const vector<QString> &strings)
+{
+    if (!b.enabled("global_query"))
+        return;
+
+    // Distribute the corpus over the handlers
+    vector<unique_ptr<BenchQueryHandler>> handlers;
+    for (uint h = 0; h < global_handler_count; ++h)
+    {
+        vector<QString> shard;
+        for (size_t i = h; i < strings.size(); i += global_handler_count)
+            shard.emplace_back(strings[i]);
+        handlers.emplace_back(make_unique<BenchQueryHandler>(
+            QStringLiteral("bench_global_%1").arg(h), indexItems(shard)));
+        registry.registerExtension(handlers.back().get());
+    }
+
+    for (auto length : query_lengths)
+    {
+        const auto qs = queries(strings, length, false);
+        b.run("global_query",
+              {{"corpus", kind}, {"size", (qint64)strings.size()},
+               {"handlers", (qint64)global_handler_count}, {"query_length", length}},
+              [&]{
+                  for (const auto &q : qs)
+                  {
+                      auto query = engine.query(q);
+                      QEventLoop loop;
+                      QObject::connect(query.get(), &Query::activeChanged, &loop,
+                                       [&](bool active){ if (!active) loop.quit(); });
+                      query->run();
+                      loop.exec();
+                      QCoreApplication::processEvents();  // collect the results
+                  }
+              }, qs.size());
+    }
+
+    for (auto &h : handlers)
+        registry.deregisterExtension(h.get());
+}
+
+
+// -------------------------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    // Keep the user data out of this
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("albert_bench");
+    QCoreApplication::setApplicationVersion(ALBERT_VERSION_STRING);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Albert benchmark suite. Prints the results as JSON.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"sizes", "Comma separated corpus sizes.", "sizes", "1000,10000,100000"},
+        {"corpora", "Comma separated corpus kinds (apps, paths, unicode).", "kinds",
+         corpus_kinds.join(',')},
+        {"filter", "Run only benchmarks whose name matches the regular expression.", "regex",
+         "."},
+        {"time", "Time budget per benchmark in milliseconds.", "ms", "500"},
+        {"output", "Write the results to a file instead of stdout.", "file"},
+    });
+    parser.process(app);
+
+    vector<size_t> sizes;
+    for (const auto &s : parser.value("sizes").split(',', Qt::SkipEmptyParts))
+        sizes.emplace_back(s.toULongLong());
+
+    // Start with fresh usage scores
+    QFile::remove(QString::fromStdString((dataLocation() / "albert.db").string()));
+
+    ExtensionRegistry registry;
+    QueryEngine engine(registry);
+    Benchmark b(parser);
+
+    for (const auto &kind : parser.value("corpora").split(',', Qt::SkipEmptyParts))
+        for (auto size : sizes)
+        {
+            const auto strings = corpus(kind, size);
+            benchmarkIndex(b, kind, strings);
+            benchmarkMatcher(b, kind, strings);
+            benchmarkScoring(b, kind, strings);
+            benchmarkGlobalQuery(b, engine, registry, kind, strings);
+        }
+
+    const QJsonObject report{
+        {"version", ALBERT_VERSION_STRING},
+        {"qt_version", qVersion()},
+        {"seed", (qint64)seed},
+        {"time_budget_ms", parser.value("time").toInt()},
+        {"results", b.results}
+    };
+
+    const auto json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet("output"))
+    {
+        QFile f(parser.value("output"));
+        if (!f.open(QIODevice::WriteOnly))
+        {
+            QTextStream(stderr) << "Failed to open output file: " << f.errorString() << Qt::endl;
+            return 1;
+        }
+        f.write(json);
+    }
+    else
+        QTextStream(stdout) << json;
+
+    return 0;
+}
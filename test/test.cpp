@@ -1,13 +1,43 @@
 // Copyright (c) 2024 Manuel Schneider
 
+#include "albert.h"
+#include "asyncpixmaploader.h"
+#include "extensionregistry.h"
+#include "iconprovider.h"
+#include "indexqueryhandler.h"
 #include "inputhistory.h"
 #include "itemindex.h"
 #include "levenshtein.h"
 #include "matcher.h"
+#include "pixmapcache.h"
+#include "plugininstance.h"
+#include "pluginloader.h"
+#include "pluginmetadata.h"
+#include "pluginprovider.h"
+#include "pluginregistry.h"
+#include "queryexecution.h"
+#include "querystatistics.h"
+#include "rpcserver.h"
+#include "settingsstore.h"
 #include "standarditem.h"
 #include "test.h"
 #include "topologicalsort.hpp"
+#include "trace.h"
+#include "triggerqueryhandlerproxy.h"
+#include <QEventLoop>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSettings>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QtEndian>
+#include <filesystem>
+#include <map>
 #include <set>
+#include <thread>
 #include <unistd.h>
 using namespace albert::util;
 using namespace albert;
@@ -49,6 +79,32 @@ void AlbertTests::topological_sort_not_existing_node()
     QCOMPARE(result.error_set, expect);
 }
 
+void AlbertTests::topological_sort_partial()
+{
+    auto result = topologicalSort(map<int, set<int>>{{1, {}}, {2, {1, 9}}, {3, {2}}, {4, {1}}});
+    auto expect_sorted = vector<int>{1, 4};
+    auto expect_errors = map<int, set<int>>{{2, {9}}, {3, {2}}};
+    QCOMPARE(result.sorted, expect_sorted);
+    QCOMPARE(result.error_set, expect_errors);
+}
+
+void AlbertTests::topological_waves_diamond()
+{
+    auto result = topologicalWaves(map<int, set<int>>{{1, {}}, {2, {1}}, {3, {1}}, {4, {2, 3}}, {5, {}}, {6, {4, 5}}});
+    auto expect = vector<vector<int>>{{1, 5}, {2, 3}, {4}, {6}};
+    QCOMPARE(result.waves, expect);
+    QVERIFY(result.error_set.empty());
+}
+
+void AlbertTests::topological_waves_cycle()
+{
+    auto result = topologicalWaves(map<int, set<int>>{{1, {}}, {2, {1, 3}}, {3, {2}}});
+    auto expect_waves = vector<vector<int>>{{1}};
+    auto expect_errors = map<int, set<int>>{{2, {3}}, {3, {2}}};
+    QCOMPARE(result.waves, expect_waves);
+    QCOMPARE(result.error_set, expect_errors);
+}
+
 void AlbertTests::levenshtein_fast_levenshtein_threshold()
 {
     Levenshtein l;
@@ -318,6 +374,32 @@ static auto indexMatch(const QStringList &item_strings,
     return index.search(search_string, true);
 };
 
+static void compareIndexMatches(const QStringList &item_strings,
+                                const QString &search_string,
+                                const MatchConfig &config,
+                                const MatchConfig &other_config)
+{
+    auto m = indexMatch(item_strings, search_string, config);
+    auto o = indexMatch(item_strings, search_string, other_config);
+    QCOMPARE(o.size(), m.size());
+
+    const auto by_id = [](auto &l, auto &r){ return l.item->id() < r.item->id(); };
+    sort(m.begin(), m.end(), by_id);
+    sort(o.begin(), o.end(), by_id);
+    for (size_t i = 0; i < m.size(); ++i)
+    {
+        QCOMPARE(o[i].item->id(), m[i].item->id());
+        QVERIFY(qFuzzyCompare(o[i].score, m[i].score));
+    }
+}
+
+static const QStringList fuzzy_strings{"firefox", "firefly", "fire fox", "thunderbird",
+                                       "thunder", "fixer", "terminal", "terminator", "term",
+                                       "ferment", "firmware"};
+
+static const QStringList fuzzy_queries{"firefix", "firefx", "fierfox", "thundrbird", "termnal",
+                                       "frm", "fire fux", "firm", "frie", "thnder", "trem"};
+
 void AlbertTests::index_empty()
 {
     auto m = indexMatch({"a","A"}, "");
@@ -383,6 +465,46 @@ void AlbertTests::index_fuzzy()
     QVERIFY(indexMatch(abc, "abc_e_g_", c).size() == 0);
 }
 
+void AlbertTests::index_fuzzy_automaton()
+{
+    QStringList abc{"abcdefghijklmnopqrstuvwxyz"};
+
+    MatchConfig c = {
+        .fuzzy = true,
+        .separator_regex = QRegularExpression("[ ]+"),
+        .fuzzy_lookup = MatchConfig::FuzzyLookup::Automaton
+    };
+
+    QVERIFY(indexMatch(abc, "abcd", c).size() == 1);
+    QVERIFY(indexMatch(abc, "abc_", c).size() == 1);
+    QVERIFY(indexMatch(abc, "ab__", c).size() == 0);
+    QVERIFY(indexMatch(abc, "abcdefgh", c).size() == 1);
+    QVERIFY(indexMatch(abc, "abcdefg_", c).size() == 1);
+    QVERIFY(indexMatch(abc, "abcde_g_", c).size() == 1);
+    QVERIFY(indexMatch(abc, "abc_e_g_", c).size() == 0);
+
+    // Same results as the nGram lookup
+    for (const auto &query : fuzzy_queries)
+        compareIndexMatches(fuzzy_strings, query, {.fuzzy = true},
+                            {.fuzzy = true, .fuzzy_lookup = MatchConfig::FuzzyLookup::Automaton});
+}
+
+void AlbertTests::index_fuzzy_deletions()
+{
+    // Same results as the nGram lookup, for words longer than the index length too
+    for (uint length : {4, 6, 9})
+        for (const auto &query : fuzzy_queries)
+            compareIndexMatches(fuzzy_strings, query, {.fuzzy = true},
+                                {.fuzzy = true, .typo_index_length = length});
+
+    // Combined with the automaton for longer words
+    for (const auto &query : fuzzy_queries)
+        compareIndexMatches(fuzzy_strings, query, {.fuzzy = true},
+                            {.fuzzy = true,
+                             .fuzzy_lookup = MatchConfig::FuzzyLookup::Automaton,
+                             .typo_index_length = 5});
+}
+
 void AlbertTests::index_case()
 {
     auto m = indexMatch({"a","A"}, "a", {});
@@ -411,6 +533,347 @@ void AlbertTests::index_score()
     QVERIFY(qFuzzyCompare(m[1].score, 3./4.));
 }
 
+void AlbertTests::index_multiple_selectivity()
+{
+    // The rare second word is evaluated first, the order has to be preserved nonetheless
+    QStringList strings{"alpha firefox", "firefox alpha", "apple", "avocado fig", "alpha beta"};
+    for (int i = 0; i < 100; ++i)
+        strings << QString("a%1").arg(i);
+
+    auto m = indexMatch(strings, "a fi", {.ignore_word_order = false});
+    QVERIFY(m.size() == 2);
+    sort(m.begin(), m.end(), [](auto &a, auto &b){ return a.item->id() < b.item->id(); });
+    QCOMPARE(m[0].item->id(), "alpha firefox");
+    QVERIFY(qFuzzyCompare(m[0].score, 3./12.));
+    QCOMPARE(m[1].item->id(), "avocado fig");
+    QVERIFY(qFuzzyCompare(m[1].score, 3./10.));
+
+    QVERIFY(indexMatch(strings, "a fi").size() == 3);
+    QVERIFY(indexMatch(strings, "alpha firefax", {.fuzzy = true}).size() == 2);
+    QVERIFY(indexMatch(strings, "a zzz").empty());
+
+    // Rare exact words are prefiltered on their postings
+    QVERIFY(indexMatch(strings, "beta alpha").size() == 1);
+    QVERIFY(indexMatch(strings, "firefox alp").size() == 2);
+    QVERIFY(indexMatch(strings, "apple fig").empty());
+}
+
+void AlbertTests::index_parallel_build()
+{
+    // Large enough to be sharded. Items have strings in different shards.
+    const int item_count = 10000;
+    const auto itemStrings = [](int i){
+        return QStringList{QString("alpha%1 beta%2").arg(i).arg(i % 97),
+                           QString("gamma%1 delta").arg(i % 1013)};
+    };
+
+    vector<shared_ptr<StandardItem>> items;
+    vector<IndexItem> index_items;
+    for (int i = 0; i < item_count; ++i)
+    {
+        items.emplace_back(make_shared<StandardItem>(QString::number(i)));
+        index_items.emplace_back(items.back(), itemStrings(i)[0]);
+    }
+    for (int i = 0; i < item_count; ++i)
+        index_items.emplace_back(items[i], itemStrings(i)[1]);
+    index_items.emplace_back(items[0], "-");  // empty tokenization
+
+    const MatchConfig config{.fuzzy = true};
+    ItemIndex index(config);
+    index.setItems(::move(index_items));
+
+    // The score of an item depends on its strings only
+    for (const auto &query : {"alpha12 b", "beta7", "gamma10 delta", "alpah99", "delta gamma1012"})
+    {
+        map<QString, double> expected;
+        for (int i = 0; i < item_count; ++i)
+            for (const auto &m : indexMatch(itemStrings(i), query, config))
+                expected[QString::number(i)] = max(expected[QString::number(i)], m.score);
+
+        const auto matches = index.search(query, true);
+        QCOMPARE(matches.size(), expected.size());
+        for (const auto &m : matches)
+        {
+            QVERIFY(expected.contains(m.item->id()));
+            QVERIFY(qFuzzyCompare(m.score, expected[m.item->id()]));
+        }
+    }
+}
+
+void AlbertTests::index_builder()
+{
+    const MatchConfig config{.fuzzy = true};
+
+    vector<shared_ptr<StandardItem>> items;
+    vector<IndexItem> index_items;
+    ItemIndex built(config);
+    auto builder = ItemIndex::builder(config, [&](ItemIndex &&i){ built = ::move(i); });
+    for (const auto &string : fuzzy_strings)
+    {
+        items.emplace_back(make_shared<StandardItem>(string));
+        index_items.emplace_back(items.back(), string);
+        builder.add(items.back(), string);
+    }
+    builder.add(items.front(), "-");  // empty tokenization
+    builder.add(items.front(), "mozilla");
+    index_items.emplace_back(items.front(), "mozilla");
+    builder.commit();
+
+    ItemIndex index(config);
+    index.setItems(::move(index_items));
+
+    // Same results as setItems
+    for (const auto &query : fuzzy_queries + QStringList{"mozila", "fire mo"})
+    {
+        auto m = index.search(query, true);
+        auto b = built.search(query, true);
+        QCOMPARE(b.size(), m.size());
+        sort(m.begin(), m.end(), [](auto &l, auto &r){ return l.item->id() < r.item->id(); });
+        sort(b.begin(), b.end(), [](auto &l, auto &r){ return l.item->id() < r.item->id(); });
+        for (size_t i = 0; i < m.size(); ++i)
+        {
+            QVERIFY(b[i].item == m[i].item);
+            QVERIFY(qFuzzyCompare(b[i].score, m[i].score));
+        }
+    }
+
+    // The builder is reusable
+    builder.add(items.front(), "thunderbird");
+    builder.commit();
+    QVERIFY(built.search("thunder", true).size() == 1);
+    QVERIFY(built.search("fire", true).empty());
+}
+
+void AlbertTests::index_partitioned()
+{
+    // Larger than a partition, the halves are not. An item with strings in both halves.
+    const int string_count = 40000;
+    const auto shared = make_shared<StandardItem>("shared");
+
+    vector<shared_ptr<StandardItem>> items;
+    vector<IndexItem> first_half, second_half;
+    for (int i = 0; i < string_count; ++i)
+    {
+        items.emplace_back(make_shared<StandardItem>(QString::number(i)));
+        auto &half = i < string_count / 2 ? first_half : second_half;
+        half.emplace_back(items.back(), QString("alpha%1 beta%2 gamma").arg(i).arg(i % 101));
+    }
+    first_half.emplace_back(shared, "omega first");
+    second_half.emplace_back(shared, "omega");
+
+    const MatchConfig config{.fuzzy = true};
+    ItemIndex first(config), second(config), partitioned(config), built(config);
+
+    auto builder = ItemIndex::builder(config, [&](ItemIndex &&i){ built = ::move(i); });
+    vector<IndexItem> all_items;
+    for (const auto &half : {first_half, second_half})
+        for (const auto &index_item : half)
+        {
+            builder.add(index_item.item, index_item.string);
+            all_items.emplace_back(index_item);
+        }
+    builder.commit();
+
+    first.setItems(::move(first_half));
+    second.setItems(::move(second_half));
+    partitioned.setItems(::move(all_items));
+
+    // Items are scored independently, i.e. the union of the halves is expected
+    const auto by_id = [](auto &l, auto &r){ return l.item->id() < r.item->id(); };
+    for (const auto &query : {"alpha1234", "beta7 gamma", "alpah2345", "gamma", ""})
+    {
+        auto expected = first.search(query, true);
+        for (auto &rank_item : second.search(query, true))
+            if (rank_item.item != shared)
+                expected.emplace_back(::move(rank_item));
+        sort(expected.begin(), expected.end(), by_id);
+
+        for (auto *index : {&partitioned, &built})
+        {
+            auto matches = index->search(query, true);
+            QVERIFY(matches.size() == expected.size());
+            sort(matches.begin(), matches.end(), by_id);
+            for (size_t i = 0; i < matches.size(); ++i)
+            {
+                QVERIFY(matches[i].item == expected[i].item);
+                QVERIFY(qFuzzyCompare(matches[i].score + 1, expected[i].score + 1));
+            }
+        }
+    }
+
+    // The highest score of an item across partitions
+    for (auto *index : {&partitioned, &built})
+    {
+        const auto matches = index->search("omega", true);
+        QVERIFY(matches.size() == 1);
+        QVERIFY(qFuzzyCompare(matches[0].score, 1.));
+    }
+
+    // Cancelled searches yield no results
+    const bool invalid = false;
+    QVERIFY(partitioned.search("gamma", invalid).empty());
+}
+
+void AlbertTests::index_infix()
+{
+    QStringList strings{"firefox", "fox", "thunderbird", "path/to/document"};
+    const MatchConfig c{.infix = true};
+    const auto by_score = [](auto &l, auto &r){ return l.score > r.score; };
+
+    QVERIFY(indexMatch(strings, "fox").size() == 1);
+
+    // Prefix matches rank above infix matches
+    auto m = indexMatch(strings, "fox", c);
+    QVERIFY(m.size() == 2);
+    sort(m.begin(), m.end(), by_score);
+    QCOMPARE(m[0].item->id(), "fox");
+    QVERIFY(qFuzzyCompare(m[0].score, 1.));
+    QCOMPARE(m[1].item->id(), "firefox");
+    QVERIFY(qFuzzyCompare(m[1].score, 1./7.));
+
+    m = indexMatch(strings, "bird", c);
+    QVERIFY(m.size() == 1);
+    QVERIFY(qFuzzyCompare(m[0].score, 2./11.));
+
+    // Too short for infixes
+    QVERIFY(indexMatch(strings, "o", c).empty());
+
+    // Multiple words, combined with fuzzy matching
+    m = indexMatch(strings, "cument pa", c);
+    QVERIFY(m.size() == 1);
+    QVERIFY(qFuzzyCompare(m[0].score, 5./14.));
+    QVERIFY(indexMatch(strings, "cument pa", {.fuzzy = true, .infix = true}).size() == 1);
+    QVERIFY(indexMatch(strings, "thunderbrd", {.fuzzy = true, .infix = true}).size() == 1);
+    QVERIFY(indexMatch(strings, "zz", c).empty());
+
+    // Words exceeding the offset range match by prefix only
+    const auto long_word = QString(70000, 'b') + "fox";
+    QVERIFY(indexMatch({long_word}, "fox", c).empty());
+    QVERIFY(indexMatch({long_word}, "bbb", c).size() == 1);
+}
+
+void AlbertTests::index_initials()
+{
+    QStringList strings{"Visual Studio Code", "VisualStudioCode", "vscode",
+                        "GNU Image Manipulation Program", "Virtual Machine"};
+    const MatchConfig c{.initials = true};
+    const auto ids = [](const vector<RankItem> &m){
+        set<QString> s;
+        for (const auto &r : m)
+            s.insert(r.item->id());
+        return s;
+    };
+    const auto score = [](const vector<RankItem> &m, const QString &id){
+        return ranges::find_if(m, [&](const auto &r){ return r.item->id() == id; })->score;
+    };
+
+    // Disabled by default
+    QVERIFY(ids(indexMatch(strings, "vsc")) == set<QString>{"vscode"});
+
+    // Initials scores are the matched fraction of the initials, below any word match score
+    const double w = 1. / 65536.;
+
+    auto m = indexMatch(strings, "vsc", c);
+    QVERIFY(ids(m) == set<QString>({"Visual Studio Code", "VisualStudioCode", "vscode"}));
+    QVERIFY(qFuzzyCompare(score(m, "Visual Studio Code"), w));
+    QVERIFY(qFuzzyCompare(score(m, "VisualStudioCode"), w));
+    QVERIFY(qFuzzyCompare(score(m, "vscode"), 0.5));  // word match
+
+    m = indexMatch(strings, "gimp", c);
+    QVERIFY(m.size() == 1);
+    QCOMPARE(m[0].item->id(), "GNU Image Manipulation Program");
+    QVERIFY(qFuzzyCompare(m[0].score, w));
+
+    // Prefixes of the initials
+    m = indexMatch(strings, "vs", c);
+    QVERIFY(ids(m) == set<QString>({"Visual Studio Code", "VisualStudioCode", "vscode"}));
+    QVERIFY(qFuzzyCompare(score(m, "Visual Studio Code"), w * 2. / 3.));
+    QVERIFY(qFuzzyCompare(score(m, "vscode"), 1. / 3.));
+
+    // Single characters match words only
+    QVERIFY(indexMatch(strings, "v", c).size() == 4);
+
+    // The higher score of word and initials matches, i.e. the word match
+    m = indexMatch({"vm Machine"}, "vm", c);
+    QVERIFY(m.size() == 1);
+    QVERIFY(qFuzzyCompare(m[0].score, 2. / 9.));
+
+    // Word matches rank above initials matches
+    m = indexMatch({"Calendar Of Dev Events", "Code - OSS", "Visual Studio Code"}, "code", c);
+    QVERIFY(m.size() == 3);
+    ranges::sort(m, greater());
+    QCOMPARE(m[2].item->id(), "Calendar Of Dev Events");
+    QVERIFY(m[2].score < m[1].score);
+    QVERIFY(qFuzzyCompare(m[2].score, w));
+
+    QVERIFY(ids(indexMatch(strings, "vsc", {.ignore_case = false, .initials = true}))
+            == set<QString>{"vscode"});
+}
+
+namespace
+{
+
+class TestQueryExecution : public QueryExecution
+{
+public:
+    using QueryExecution::QueryExecution;
+    void waitForFinished() { future_watcher_.waitForFinished(); }
+};
+
+class ConfiguredIndexHandler : public IndexQueryHandler
+{
+public:
+    QString id() const override { return "configured_index"; }
+    QString name() const override { return {}; }
+    QString description() const override { return {}; }
+    MatchConfig matchConfig() const override { return config; }
+    void updateIndexItems() override
+    {
+        ++updates;
+        setIndexItems({IndexItem(make_shared<StandardItem>("firefox"), "firefox")});
+    }
+    MatchConfig config{.infix = true};
+    int updates = 0;
+};
+
+}
+
+void AlbertTests::index_query_handler_config()
+{
+    for (const auto lookup : {MatchConfig::FuzzyLookup::NGram, MatchConfig::FuzzyLookup::Automaton})
+    for (const uint typo_index_length : {0u, 8u})
+    {
+        ConfiguredIndexHandler handler;
+        handler.config.fuzzy_lookup = lookup;
+        handler.config.typo_index_length = typo_index_length;
+        const auto search = [&](const QString &string)
+        {
+            TestQueryExecution query(nullptr, {}, &handler, string, {});
+            return handler.handleGlobalQuery(query);
+        };
+
+        handler.setFuzzyMatching(false);
+        QVERIFY(handler.updates == 1);
+        QVERIFY(search("fox").size() == 1);
+        QVERIFY(search("fiefox").empty());
+
+        // The config survives fuzzy toggles
+        handler.setFuzzyMatching(true);
+        QVERIFY(handler.updates == 2);
+        QVERIFY(search("fox").size() == 1);
+        QVERIFY(search("fiefox").size() == 1);
+        QVERIFY(search("firefx").size() == 1);
+
+        handler.setFuzzyMatching(true);
+        QVERIFY(handler.updates == 2);
+
+        handler.setFuzzyMatching(false);
+        QVERIFY(handler.updates == 3);
+        QVERIFY(search("fox").size() == 1);
+        QVERIFY(search("fiefox").empty());
+    }
+}
+
 void AlbertTests::input_history()
 {
     QTemporaryFile t;
@@ -476,6 +939,704 @@ void AlbertTests::input_history()
 
 }
 
+void AlbertTests::input_history_persistence()
+{
+    QTemporaryFile t;
+    t.open(); t.close(); // required to get the filename
+
+    {
+        InputHistory h(t.fileName());
+        h.add("alpha");
+        h.add("beta");
+        h.add("gamma");
+        h.add("alpha");  // duplicate, moves to the front
+    }
+
+    InputHistory h(t.fileName());
+    QCOMPARE(h.next(), "alpha");
+    QCOMPARE(h.next(), "gamma");
+    QCOMPARE(h.next(), "beta");
+    QCOMPARE(h.next(), "");
+
+    // indexed search (pattern length >= 3)
+    h.resetIterator();
+    QCOMPARE(h.next("AMM"), "gamma");
+    QCOMPARE(h.next("AMM"), "");
+    QCOMPARE(h.prev("xyz"), "");
+
+    // limit drops the oldest entries, also from the file
+    h.setLimit(2);
+    h.add("delta");
+    QCOMPARE(h.next(), "delta");
+    QCOMPARE(h.next(), "alpha");
+    QCOMPARE(h.next(), "");
+
+    InputHistory r(t.fileName());
+    r.setLimit(2);
+    QCOMPARE(r.next(), "delta");
+    QCOMPARE(r.next(), "alpha");
+    QCOMPARE(r.next(), "");
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void AlbertTests::settings_store()
+{
+    // The write-back timer needs an event loop
+    QStandardPaths::setTestModeEnabled(true);
+    int argc = 1;
+    char arg[] = "albert_test";
+    char *argv[] = {arg};
+    QCoreApplication app(argc, argv);
+
+    auto &store = SettingsStore::config();
+    const auto fileValue = [&](const QString &key)
+    { return QSettings(store.fileName(), QSettings::IniFormat).value(key); };
+
+    store.remove("test");
+    store.sync();
+    QVERIFY(!fileValue("test/bool").isValid());
+
+    // Round trip, typed values read as before and from the file
+    store.setValue("test/bool", true);
+    store.setValue("test/int", 42);
+    store.setValue("test/string", QString("s"));
+    store.setValue("test/list", QStringList{"a", "b"});
+    QVERIFY(store.value("test/bool").toBool());
+    QVERIFY(store.value<int>("test/int", 0) == 42);
+    QVERIFY(store.value<int>("test/missing", 1) == 1);
+
+    // Debounced write-back, the last value is written
+    store.setValue("test/int", 43);
+    QVERIFY(!fileValue("test/int").isValid());
+    QTRY_VERIFY_WITH_TIMEOUT(fileValue("test/int").toInt() == 43, 5000);
+    QVERIFY(fileValue("test/bool").toBool());
+    QCOMPARE(fileValue("test/string").toString(), "s");
+    QVERIFY(fileValue("test/list").toStringList() == QStringList({"a", "b"}));
+    store.reload();  // unchanged
+
+    QSignalSpy spy(&store, &SettingsStore::valueChanged);
+
+    // External changes are noticed. Values read from the file, e.g. "true", equal the values
+    // set before, i.e. are not reported as changed.
+    {
+        QSettings s(store.fileName(), QSettings::IniFormat);
+        s.setValue("test/external", "e");
+        s.setValue("test/int", 44);
+    }
+    store.reload();
+    QVERIFY(spy.size() == 2);
+    QVERIFY(store.value("test/external").toString() == "e");
+    QVERIFY(store.value("test/int").toInt() == 44);
+    QVERIFY(store.value("test/bool").toBool());
+    store.setValue("test/bool", true);
+    store.setValue("test/list", QStringList{"a", "b"});
+    QVERIFY(spy.size() == 2);
+
+    // The legacy QSettings objects reload the store on changes
+    spy.clear();
+    albert::settings()->setValue("test/legacy", 1);
+    QVERIFY(spy.size() == 1);
+    QVERIFY(store.value("test/legacy").toInt() == 1);
+
+    // The legacy QSettings objects see pending changes, which do not override their changes
+    store.setValue("test/pending", 1);
+    {
+        auto s = albert::settings();
+        QVERIFY(s->value("test/pending").toInt() == 1);
+        s->setValue("test/pending", 2);
+    }
+    QVERIFY(store.value("test/pending").toInt() == 2);
+    store.sync();
+    QVERIFY(fileValue("test/pending").toInt() == 2);
+
+    // Removing a key removes its subkeys, not keys having it as prefix
+    store.setValue("test/sub/a", 1);
+    store.setValue("test/sub/b/c", 2);
+    store.setValue("test/subx", 3);
+    spy.clear();
+    store.remove("test/sub");
+    QVERIFY(spy.size() == 2);
+    QVERIFY(!store.contains("test/sub/a"));
+    QVERIFY(!store.contains("test/sub/b/c"));
+    QVERIFY(store.contains("test/subx"));
+    store.sync();
+    QVERIFY(!fileValue("test/sub/b/c").isValid());
+    QVERIFY(fileValue("test/subx").toInt() == 3);
+
+    store.remove("test");
+    store.sync();
+}
+
+void AlbertTests::histogram_percentiles()
+{
+    Histogram h;
+    QCOMPARE(h.count(), uint64_t(0));
+    QCOMPARE(h.percentile(50), uint64_t(0));
+
+    // Small values are exact
+    for (uint64_t v : {1, 2, 3, 4})
+        h.record(v);
+    QCOMPARE(h.percentile(50), uint64_t(2));
+    QCOMPARE(h.percentile(100), uint64_t(4));
+
+    // Relative error of at most 1/32
+    Histogram l;
+    for (uint64_t v = 1; v <= 100000; ++v)
+        l.record(v);
+    QCOMPARE(l.count(), uint64_t(100000));
+    for (auto [p, expected] : {pair{50., 50000.}, pair{95., 95000.}, pair{99., 99000.}})
+    {
+        const auto actual = (double)l.percentile(p);
+        QVERIFY(actual >= expected);
+        QVERIFY(actual <= expected * (1. + 1. / 32.));
+    }
+
+    // Huge values are clamped
+    l.record(numeric_limits<uint64_t>::max());
+    QCOMPARE(l.percentile(100), Histogram::bucketUpperBound(Histogram::bucket_count - 1));
+}
+
+void AlbertTests::trace_chrome_json()
+{
+    Trace::setEnabled(true);
+    Trace::clear();
+    Trace::record("span", "detail", 10, 25);
+    {
+        TraceSpan span("scoped");
+    }
+    Trace::setEnabled(false);
+    {
+        TraceSpan span("disabled");
+    }
+
+    const auto doc = QJsonDocument::fromJson(Trace::chromeTraceJson());
+    QVERIFY(doc.isObject());
+    QCOMPARE(doc["displayTimeUnit"].toString(), "ms");
+
+    map<QString, QJsonObject> spans;
+    QJsonObject thread;
+    for (const auto &v : doc["traceEvents"].toArray())
+    {
+        const auto e = v.toObject();
+        if (e["ph"] == "M")
+            thread = e;
+        else
+        {
+            QCOMPARE(e["ph"].toString(), "X");
+            spans.emplace(e["name"].toString(), e);
+        }
+    }
+
+    // Thread metadata
+    QCOMPARE(thread["name"].toString(), "thread_name");
+    QVERIFY(!thread["args"]["name"].toString().isEmpty());
+    QVERIFY(thread["pid"] == QCoreApplication::applicationPid());
+
+    QVERIFY(spans.size() == 2);
+    QVERIFY(!spans.contains("disabled"));
+
+    const auto &s = spans["span"];
+    QCOMPARE(s["cat"].toString(), "albert");
+    QVERIFY(s["ts"].toInteger() == 10);
+    QVERIFY(s["dur"].toInteger() == 15);
+    QCOMPARE(s["args"]["detail"].toString(), "detail");
+    QVERIFY(s["pid"] == thread["pid"]);
+    QVERIFY(s["tid"] == thread["tid"]);
+
+    QVERIFY(spans["scoped"]["dur"].toInteger() >= 0);
+    QVERIFY(!spans["scoped"].contains("args"));
+
+    Trace::clear();
+    QVERIFY(QJsonDocument::fromJson(Trace::chromeTraceJson())["traceEvents"].toArray().isEmpty());
+}
+
+namespace
+{
+
+class CountingHandler : public TriggerQueryHandler
+{
+public:
+    QString id() const override { return "counting"; }
+    QString name() const override { return {}; }
+    QString description() const override { return {}; }
+    void handleTriggerQuery(Query &q) override
+    {
+        const shared_ptr<Item> item = make_shared<StandardItem>("a");
+        q.add(item);
+        q.add(make_shared<StandardItem>("b"));
+
+        const vector<shared_ptr<Item>> items{make_shared<StandardItem>("c"),
+                                             make_shared<StandardItem>("d")};
+        q.add(items);
+        q.add(vector<shared_ptr<Item>>{make_shared<StandardItem>("e"),
+                                       make_shared<StandardItem>("f"),
+                                       make_shared<StandardItem>("g")});
+    }
+};
+
+}
+
+void AlbertTests::query_result_counts()
+{
+    CountingHandler handler;
+    TestQueryExecution query(nullptr, {}, &handler, {}, {});
+    query.run();
+    query.waitForFinished();
+
+    const auto runtimes = query.handlerRuntimes();
+    QVERIFY(runtimes.size() == 1);
+    QCOMPARE(runtimes[0].id, "counting");
+    QVERIFY(runtimes[0].count == 7);
+    QVERIFY(runtimes[0].scoring.count() < 0);  // not scored
+}
+
+namespace
+{
+
+class LazyHandler : public TriggerQueryHandler
+{
+public:
+    QString id() const override { return "lazy_test"; }
+    QString name() const override { return "Lazy"; }
+    QString description() const override { return "Lazy test handler"; }
+    QString synopsis(const QString &) const override { return "<query>"; }
+    QString defaultTrigger() const override { return "lz "; }
+    void handleTriggerQuery(Query &) override {}
+};
+
+class LazyPluginInstance : public PluginInstance
+{
+public:
+    vector<Extension*> extensions() override { return {&handler}; }
+    LazyHandler handler;
+};
+
+class LazyPluginLoader : public PluginLoader
+{
+public:
+    QString path() const override { return "/test/lazy_test"; }
+    const PluginMetaData &metaData() const override { return metadata; }
+    void load() override {}
+    void unload() override { instance.reset(); }
+    PluginInstance *createInstance() override
+    {
+        ++instantiations;
+        instance = make_unique<LazyPluginInstance>();
+        return instance.get();
+    }
+
+    PluginMetaData metadata{.iid = {}, .id = "lazy_test", .version = "1.0.0", .name = "Lazy",
+                            .description = "Lazy test plugin", .license = "MIT",
+                            .url = "https://albertlauncher.github.io", .translations = {},
+                            .authors = {"test"}, .runtime_dependencies = {},
+                            .binary_dependencies = {}, .plugin_dependencies = {},
+                            .third_party_credits = {}, .platforms = {},
+                            .load_type = PluginMetaData::LoadType::User,
+                            .lazy_activation = true};
+    unique_ptr<LazyPluginInstance> instance;
+    int instantiations = 0;
+};
+
+class LazyPluginProvider : public PluginProvider
+{
+public:
+    QString id() const override { return "lazy_test_provider"; }
+    QString name() const override { return {}; }
+    QString description() const override { return {}; }
+    vector<PluginLoader*> plugins() override { return {&loader}; }
+    LazyPluginLoader loader;
+};
+
+}
+
+void AlbertTests::plugin_lazy_activation_proxy()
+{
+    LazyHandler handler;
+    int activations = 0;
+    TriggerQueryHandlerProxy proxy(TriggerQueryHandlerProxy::record(&handler),
+                                   [&]{ ++activations; });
+
+    QCOMPARE(proxy.id(), handler.id());
+    QCOMPARE(proxy.name(), handler.name());
+    QCOMPARE(proxy.description(), handler.description());
+    QCOMPARE(proxy.synopsis("x"), "<query>");
+    QCOMPARE(proxy.defaultTrigger(), "lz ");
+    QVERIFY(proxy.allowTriggerRemap() == handler.allowTriggerRemap());
+    QVERIFY(proxy.supportsFuzzyMatching() == handler.supportsFuzzyMatching());
+
+    // Activates once
+    TestQueryExecution query(nullptr, {}, &proxy, {}, {});
+    proxy.handleTriggerQuery(query);
+    proxy.handleTriggerQuery(query);
+    QVERIFY(activations == 1);
+}
+
+void AlbertTests::plugin_lazy_activation()
+{
+    // Activation is queued to the event loop
+    QStandardPaths::setTestModeEnabled(true);
+    int argc = 1;
+    char arg[] = "albert_test";
+    char *argv[] = {arg};
+    QCoreApplication app(argc, argv);
+
+    auto &config = SettingsStore::config();
+    config.setValue("lazy_plugin_activation", true);
+    config.setValue("lazy_test/enabled", true);
+    SettingsStore::state().remove("lazy_activation");
+
+    ExtensionRegistry extensions;
+    PluginRegistry plugins(extensions);
+    LazyPluginProvider provider;
+    auto &loader = provider.loader;
+    const auto registered = [&]{ return extensions.extensions().at("lazy_test"); };
+
+    // Loaded until the handlers have been recorded
+    extensions.registerExtension(&provider);
+    QVERIFY(loader.instantiations == 1);
+    QVERIFY(dynamic_cast<LazyHandler*>(registered()));
+    extensions.deregisterExtension(&provider);
+
+    // Then represented by proxies
+    extensions.registerExtension(&provider);
+    QVERIFY(loader.instantiations == 1);
+    auto *proxy = dynamic_cast<TriggerQueryHandlerProxy*>(registered());
+    QVERIFY(proxy);
+    QCOMPARE(proxy->defaultTrigger(), "lz ");
+    QVERIFY(plugins.plugins().at("lazy_test").state() == Plugin::State::Unloaded);
+
+    // The first use loads the plugin, which replaces the proxies
+    {
+        QSignalSpy spy(&plugins, &PluginRegistry::activatedOnFirstUse);
+        TestQueryExecution query(nullptr, {}, proxy, {}, {});
+        proxy->handleTriggerQuery(query);
+        proxy->handleTriggerQuery(query);
+        QVERIFY(spy.wait(5000));
+        QVERIFY(spy.size() == 1);
+        QCOMPARE(spy[0][0].toString(), "lazy_test");
+    }
+    QVERIFY(loader.instantiations == 2);
+    QVERIFY(dynamic_cast<LazyHandler*>(registered()));
+    QVERIFY(plugins.plugins().at("lazy_test").state() == Plugin::State::Loaded);
+    extensions.deregisterExtension(&provider);
+
+    // Plugins that do not opt in are loaded regardless of recorded handlers
+    loader.metadata.lazy_activation = false;
+    extensions.registerExtension(&provider);
+    QVERIFY(loader.instantiations == 3);
+    QVERIFY(dynamic_cast<LazyHandler*>(registered()));
+    extensions.deregisterExtension(&provider);
+
+    config.remove("lazy_plugin_activation");
+    config.remove("lazy_test");
+    SettingsStore::state().remove("lazy_activation");
+    config.sync();
+    SettingsStore::state().sync();
+}
+
+void AlbertTests::pixmap_cache()
+{
+    // Pixmaps require a gui application
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    int argc = 1;
+    char arg[] = "albert_test";
+    char *argv[] = {arg};
+    QGuiApplication app(argc, argv);
+
+    auto &cache = PixmapCache::instance();
+    cache.clear();
+    const auto capacity = cache.capacity();
+    const auto pixmap = [](int size){ QPixmap pm(size, size); pm.fill(Qt::red); return pm; };
+    const auto key = [](const QString &url){ return PixmapCache::Key{url, {64, 64}, 1.}; };
+
+    // Byte accounting
+    cache.insert(key("a"), pixmap(64));
+    const auto cost = cache.statistics().bytes;
+    QVERIFY(cost >= (size_t)64 * 64 * pixmap(64).depth() / 8);
+    cache.insert(key("a"), pixmap(64));  // replaces
+    QVERIFY(cache.statistics().bytes == cost);
+    cache.insert(key("b"), pixmap(64));
+    QVERIFY(cache.statistics().bytes == 2 * cost);
+    QVERIFY(cache.statistics().entries == 2);
+
+    // LRU eviction
+    cache.setCapacity(2 * cost + cost / 2);
+    QVERIFY(cache.lookup(key("a")));  // most recently used
+    const auto evictions = cache.statistics().evictions;
+    cache.insert(key("c"), pixmap(64));
+    QVERIFY(cache.statistics().evictions == evictions + 1);
+    QVERIFY(cache.lookup(key("a")));
+    QVERIFY(!cache.lookup(key("b")));
+    QVERIFY(cache.lookup(key("c")));
+    QVERIFY(cache.statistics().bytes == 2 * cost);
+    cache.setCapacity(capacity);
+
+    // High DPI pixmaps are rendered and cached once
+    cache.clear();
+    const auto misses = cache.statistics().misses;
+    const auto hidpi = pixmapFromUrl("gen:?background=red", {16, 16}, 2.);
+    QVERIFY(hidpi.size() == QSize(32, 32));
+    QVERIFY(hidpi.devicePixelRatio() == 2.);
+    QVERIFY(cache.statistics().entries == 1);
+    QVERIFY(cache.statistics().misses == misses + 1);
+
+    // Concurrent renders of a key share the result
+    const auto shared = cache.statistics().shared;
+    const auto rendered = pixmap(16);
+    QPixmap joined;
+    bool joined_rendered = false;
+    thread joiner;
+    const auto result = cache.get(key("d"), [&]
+    {
+        joiner = thread([&]{
+            joined = cache.get(key("d"), [&]{ joined_rendered = true; return QPixmap(); });
+        });
+        for (auto deadline = steady_clock::now() + 5s;
+             cache.statistics().shared == shared && steady_clock::now() < deadline;)
+            this_thread::yield();
+        return rendered;
+    });
+    joiner.join();
+    QVERIFY(cache.statistics().shared == shared + 1);
+    QVERIFY(!joined_rendered);
+    QVERIFY(result.cacheKey() == rendered.cacheKey());
+    QVERIFY(joined.cacheKey() == rendered.cacheKey());
+
+    // File icons are rendered again when the file changes
+    QTemporaryDir dir;
+    const auto path = dir.filePath("icon.png");
+    const auto url = "file:" + path;
+    const auto save = [&](int size)
+    {
+        QImage image(size, size, QImage::Format_ARGB32);
+        image.fill(Qt::red);
+        const filesystem::path p(path.toStdString());
+        const auto mtime = filesystem::exists(p) ? filesystem::last_write_time(p) : filesystem::file_time_type{};
+        QVERIFY(image.save(path));
+        if (filesystem::last_write_time(p) <= mtime)  // coarse timestamps
+            filesystem::last_write_time(p, mtime + 1s);
+    };
+    QVERIFY(pixmapFromUrl(url, {64, 64}).isNull());
+    save(16);
+    QVERIFY(pixmapFromUrl(url, {64, 64}).size() == QSize(16, 16));
+    save(32);
+    QVERIFY(pixmapFromUrl(url, {64, 64}).size() == QSize(32, 32));
+
+    // Theme changes invalidate the cache
+    cache.setThemeName("albert_test_theme");
+    cache.insert(key("a"), pixmap(16));
+    cache.setThemeName("albert_test_theme");
+    QVERIFY(cache.lookup(key("a")));
+    cache.setThemeName("albert_test_theme_2");
+    QVERIFY(cache.statistics().entries == 0);
+    QCOMPARE(cache.themeName(), "albert_test_theme_2");
+
+    const auto theme_name = QIcon::themeName();
+    QEvent theme_change(QEvent::ThemeChange);
+    cache.watchThemeChanges(&app);
+    QCOMPARE(cache.themeName(), theme_name);
+    cache.insert(key("a"), pixmap(16));
+    QCoreApplication::sendEvent(&app, &theme_change);
+    QVERIFY(cache.lookup(key("a")));
+    QIcon::setThemeName("albert_test_theme");
+    QCoreApplication::sendEvent(&app, &theme_change);
+    QVERIFY(!cache.lookup(key("a")));
+    QCOMPARE(cache.themeName(), "albert_test_theme");
+    QIcon::setThemeName(theme_name);
+
+    cache.clear();
+}
+
+void AlbertTests::async_pixmap_loader()
+{
+    // Pixmaps require a gui application
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    int argc = 1;
+    char arg[] = "albert_test";
+    char *argv[] = {arg};
+    QGuiApplication app(argc, argv);
+
+    auto &cache = PixmapCache::instance();
+    cache.clear();
+
+    QTemporaryDir dir;
+    const auto fileUrl = [&](int i){ return "file:" + dir.filePath(QString("%1.png").arg(i)); };
+    for (int i = 0; i < 10; ++i)
+    {
+        QImage image(8 + i, 8 + i, QImage::Format_ARGB32);
+        image.fill(Qt::red);
+        QVERIFY(image.save(dir.filePath(QString("%1.png").arg(i))));
+    }
+
+    // A single worker queues the requests
+    AsyncPixmapLoader loader;
+    loader.setMaxThreadCount(1);
+    const QSize size(32, 32);
+
+    vector<int> order;
+    map<int, QPixmap> ready;
+    size_t expected = 0;
+    QEventLoop loop;
+    QTimer deadline;
+    deadline.setSingleShot(true);
+    QObject::connect(&deadline, &QTimer::timeout, &loop, &QEventLoop::quit);
+    QObject::connect(&loader, &AsyncPixmapLoader::pixmapReady, &loop,
+                     [&](int row, const QPixmap &pm)
+                     {
+                         order.push_back(row);
+                         ready[row] = pm;
+                         if (ready.size() == expected)
+                             loop.quit();
+                     });
+    const auto wait = [&](size_t count)
+    {
+        order.clear();
+        ready.clear();
+        expected = count;
+        deadline.start(5000);
+        loop.exec();
+        deadline.stop();
+    };
+
+    // Visible rows are served first
+    loader.setVisibleRows(8, 9);
+    for (int row = 0; row < 10; ++row)
+        QVERIFY(loader.request(row, {fileUrl(row)}, size).isNull());  // placeholder
+    wait(10);
+    QVERIFY(ready.size() == 10);
+    const auto position = [&](int row){ return ranges::find(order, row) - order.begin(); };
+    for (int row = 1; row < 8; ++row)  // row 0 started right away
+        QVERIFY(position(8) < position(row) && position(9) < position(row));
+    QVERIFY(ready[3].size() == QSize(11, 11));
+
+    // Served from the cache then
+    QVERIFY(loader.request(3, {fileUrl(3)}, size).cacheKey() == ready[3].cacheKey());
+
+    // Cancelled rows are not served
+    cache.clear();
+    loader.setVisibleRows(0, numeric_limits<int>::max());
+    for (int row = 0; row < 3; ++row)
+        loader.request(row, {fileUrl(row)}, size);
+    loader.cancel(1);
+    wait(2);
+    QVERIFY(ready.size() == 2);
+    QVERIFY(ready.contains(0) && ready.contains(2));
+
+    // URLs that cannot be resolved in the workers fall back to the GUI thread
+    const QStringList urls{dir.filePath("missing.png"), "gen:?background=red"};
+    QVERIFY(loader.request(0, urls, size).isNull());
+    wait(1);
+    QVERIFY(ready[0].size() == size);
+    const auto missing = cache.lookup({urls[0], size, 1.});
+    QVERIFY(missing && missing->isNull());
+    QVERIFY(loader.request(0, urls, size).cacheKey() == ready[0].cacheKey());
+
+    // Renders match the synchronous ones, which share the cache
+    cache.clear();
+    loader.request(0, {fileUrl(9)}, {8, 8}, 2.);
+    wait(1);
+    QVERIFY(ready[0].devicePixelRatio() == 2.);
+    const auto image = ready[0].toImage();
+    cache.clear();
+    QVERIFY(pixmapFromUrl(fileUrl(9), {8, 8}, 2.).toImage() == image);
+
+    cache.clear();
+}
+
+void AlbertTests::rpc_request_parser()
+{
+    using Requests = vector<RPCServer::RequestParser::Request>;
+
+    const auto frame = [](quint32 id, const QByteArray &payload)
+    {
+        QByteArray f(8, Qt::Uninitialized);
+        qToBigEndian<quint32>(payload.size(), f.data());
+        qToBigEndian<quint32>(id, f.data() + 4);
+        return f + payload;
+    };
+
+    // Frames split at every byte
+    {
+        RPCServer::RequestParser parser;
+        Requests requests;
+        const auto bytes = frame(1, "hello") + frame(2, "world");
+        for (qsizetype i = 0; i < bytes.size(); ++i)
+        {
+            QVERIFY(parser.parse(bytes.mid(i, 1), requests));
+            QVERIFY(parser.isPending() == (i + 1 != 13 && i + 1 != bytes.size()));
+        }
+        QVERIFY(requests.size() == 2);
+        QVERIFY(requests[0].id == 1);
+        QVERIFY(requests[0].payload == "hello");
+        QVERIFY(!requests[0].legacy);
+        QVERIFY(requests[1].id == 2);
+        QVERIFY(requests[1].payload == "world");
+        QVERIFY(!requests[1].legacy);
+    }
+
+    // Several frames in one chunk, ids in any order, empty payload, trailing partial frame
+    {
+        RPCServer::RequestParser parser;
+        Requests requests;
+        const auto last = frame(7, "last");
+        QVERIFY(parser.parse(frame(7, "a") + frame(3, "b") + frame(7, {}) + frame(0, "c")
+                             + last.left(10), requests));
+        QVERIFY(requests.size() == 4);
+        QVERIFY(requests[0].id == 7 && requests[0].payload == "a");
+        QVERIFY(requests[1].id == 3 && requests[1].payload == "b");
+        QVERIFY(requests[2].id == 7 && requests[2].payload.isEmpty());
+        QVERIFY(requests[3].id == 0 && requests[3].payload == "c");
+        QVERIFY(parser.isPending());
+
+        requests.clear();
+        QVERIFY(parser.parse(last.mid(10), requests));
+        QVERIFY(requests.size() == 1);
+        QVERIFY(requests[0].id == 7 && requests[0].payload == "last");
+        QVERIFY(!parser.isPending());
+    }
+
+    // Oversize frames are rejected before the payload arrives
+    {
+        RPCServer::RequestParser parser;
+        Requests requests;
+        QByteArray header(8, 0);
+        qToBigEndian<quint32>(16 * 1024 * 1024 + 1, header.data());
+        QVERIFY(!parser.parse(frame(1, "ok") + header, requests));
+        QVERIFY(parser.error() != nullptr);
+        QVERIFY(!parser.isPending());
+        QVERIFY(requests.size() == 1);  // the frames before are still valid
+        QVERIFY(requests[0].payload == "ok");
+    }
+
+    // Legacy messages arriving in pieces, brackets in strings do not end the message
+    {
+        RPCServer::RequestParser parser;
+        Requests requests;
+        const QByteArray message = R"(["show", "a]b\"]c", {"x": [1, "}"]}])";
+        for (qsizetype i = 0; i < message.size(); i += 3)
+            QVERIFY(parser.parse(message.mid(i, 3), requests));
+        QVERIFY(requests.size() == 1);
+        QVERIFY(requests[0].legacy);
+        QVERIFY(requests[0].payload == message);
+        QVERIFY(!parser.isPending());
+    }
+
+    // Incomplete legacy messages stay pending, invalid ones are rejected
+    {
+        RPCServer::RequestParser parser;
+        Requests requests;
+        QVERIFY(parser.parse(R"(["show", )", requests));
+        QVERIFY(requests.empty());
+        QVERIFY(parser.isPending());
+
+        QVERIFY(!parser.parse("}", requests));
+        QVERIFY(parser.error() != nullptr);
+        QVERIFY(requests.empty());
+        QVERIFY(!parser.isPending());
+    }
+}
+
 // // -------------------------------------------------------------------------------------------------
 
 // static string gen_random(const int len) {
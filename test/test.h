@@ -13,6 +13,9 @@ private slots:
     void topological_sort_diamond();
     void topological_sort_cycle();
     void topological_sort_not_existing_node();
+    void topological_sort_partial();
+    void topological_waves_diamond();
+    void topological_waves_cycle();
 
     void levenshtein_fast_levenshtein_threshold();
     void levenshtein_fuzzy_substitution();
@@ -38,10 +41,34 @@ private slots:
     void index_diacritics();
     void index_separators();
     void index_fuzzy();
+    void index_fuzzy_automaton();
+    void index_fuzzy_deletions();
     void index_case();
     void index_score();
+    void index_multiple_selectivity();
+    void index_parallel_build();
+    void index_builder();
+    void index_partitioned();
+    void index_infix();
+    void index_initials();
+    void index_query_handler_config();
 
     void input_history();
+    void input_history_persistence();
+
+    void settings_store();
+
+    void histogram_percentiles();
+    void query_result_counts();
+
+    void plugin_lazy_activation_proxy();
+    void plugin_lazy_activation();
+    void trace_chrome_json();
+
+    void pixmap_cache();
+    void async_pixmap_loader();
+
+    void rpc_request_parser();
 
     // void benchmark_comparison_vanilla_vs_fast_levenshtein();
 